@@ -0,0 +1,113 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <vector>
+
+// Bump allocator for short-lived matrices. Allocation moves a pointer
+// forward and deallocation does nothing; reset() rewinds to the start and
+// keeps every chunk, so a loop that resets once per frame or batch stops
+// touching the upstream allocator after its first iteration.
+//
+// Pass it to a matrix directly,
+//
+//     MatrixArena arena;
+//     Matrix<float> m(2, 2, &arena);
+//
+// or install it for a whole scope with std::pmr::set_default_resource so
+// that temporaries use it as well. Matrices must not outlive the next
+// reset(). Not thread-safe: give each thread its own arena.
+//
+// For long-lived matrices of a few recurring sizes,
+// std::pmr::unsynchronized_pool_resource is the size-class alternative.
+class MatrixArena : public std::pmr::memory_resource {
+public:
+    explicit MatrixArena(size_t chunkSize = 1 << 20,
+                         std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+    : chunkSize(chunkSize), upstream(upstream) {}
+
+    ~MatrixArena() override { release(); }
+
+    MatrixArena(const MatrixArena&) = delete;
+    MatrixArena& operator=(const MatrixArena&) = delete;
+
+    // Makes all memory available again; everything allocated so far is invalid
+    void reset() {
+        current = 0;
+        offset = 0;
+    }
+
+    // Like reset(), and also returns the chunks to the upstream resource
+    void release() {
+        for (const Chunk& chunk : chunks) {
+            upstream->deallocate(chunk.data, chunk.size, alignof(std::max_align_t));
+        }
+        chunks.clear();
+        reset();
+    }
+
+    // Bytes handed out since the last reset
+    size_t bytesUsed() const {
+        size_t used = offset;
+        for (size_t i = 0; i < current && i < chunks.size(); i++) {
+            used += chunks[i].size;
+        }
+        return used;
+    }
+
+    // Bytes held from upstream
+    size_t bytesReserved() const {
+        size_t reserved = 0;
+        for (const Chunk& chunk : chunks) {
+            reserved += chunk.size;
+        }
+        return reserved;
+    }
+
+private:
+    struct Chunk {
+        std::byte* data;
+        size_t size;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t current = 0; // chunk being bumped through
+    size_t offset = 0;  // bytes used in chunks[current]
+    size_t chunkSize;
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(size_t bytes, size_t align) override {
+        while (current < chunks.size()) {
+            Chunk& chunk = chunks[current];
+            auto base = reinterpret_cast<std::uintptr_t>(chunk.data);
+            size_t start = ((base + offset + align - 1) & ~(std::uintptr_t(align) - 1)) - base;
+            if (start + bytes <= chunk.size) {
+                offset = start + bytes;
+                return chunk.data + start;
+            }
+            // Doesn't fit: move on to the next chunk, kept from before a reset
+            current++;
+            offset = 0;
+        }
+
+        // Grow geometrically, and always leave room for the request itself
+        size_t size = chunks.empty() ? chunkSize : chunks.back().size * 2;
+        if (size < bytes + align) {
+            size = bytes + align;
+        }
+        chunks.push_back({static_cast<std::byte*>(upstream->allocate(size, alignof(std::max_align_t))), size});
+        current = chunks.size() - 1;
+        offset = 0;
+        return do_allocate(bytes, align);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+#endif // ARENA_HPP
@@ -0,0 +1,52 @@
+// The counting operator new and delete of counting_allocator.hpp. Every
+// form allocates through allocate() and frees through release(), neither
+// of which is inlined, so each new is paired with a delete that frees the
+// same way and the compiler never sees free() of a pointer it knows came
+// from operator new.
+
+#include <cstdlib>
+#include <new>
+
+#include "counting_allocator.hpp"
+
+namespace counting {
+
+namespace detail {
+
+std::atomic<size_t> allocations{0};
+std::atomic<size_t> bytes{0};
+
+[[gnu::noinline]] static void* allocate(size_t size, size_t align) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    if (size == 0) {
+        size = 1;
+    }
+    void* p = align <= alignof(std::max_align_t) ? std::malloc(size)
+                                                 : std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+[[gnu::noinline]] static void release(void* p) noexcept {
+    std::free(p);
+}
+
+} // namespace detail
+
+} // namespace counting
+
+void* operator new(size_t size) {
+    return counting::detail::allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+    return counting::detail::allocate(size, static_cast<size_t>(align));
+}
+
+void operator delete(void* p) noexcept { counting::detail::release(p); }
+void operator delete(void* p, size_t) noexcept { counting::detail::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { counting::detail::release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { counting::detail::release(p); }
@@ -0,0 +1,33 @@
+#ifndef COUNTING_ALLOCATOR_HPP
+#define COUNTING_ALLOCATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+
+// Replaces the global operator new and delete of a program with ones that
+// count heap allocations and bytes; link bench/counting_allocator.cpp into
+// it to use them. The counts are atomic, so allocations made on the
+// thread pool are counted too:
+//
+//     size_t before = counting::allocations();
+//     work();
+//     size_t made = counting::allocations() - before;
+namespace counting {
+
+namespace detail {
+extern std::atomic<size_t> allocations;
+extern std::atomic<size_t> bytes;
+} // namespace detail
+
+// Heap allocations and bytes allocated since the program started
+inline size_t allocations() {
+    return detail::allocations.load(std::memory_order_relaxed);
+}
+
+inline size_t bytes() {
+    return detail::bytes.load(std::memory_order_relaxed);
+}
+
+} // namespace counting
+
+#endif // COUNTING_ALLOCATOR_HPP
@@ -0,0 +1,102 @@
+// Times LUDecomposition against Eigen::PartialPivLU on the same random
+// matrices: the factorization, determinant and inverse, single run after
+// a warm-up, best of several repetitions. Also prints the residual
+// |P A - L U| / |A| of our factors and |A A^-1 - I| of both inverses.
+//
+//     lu_bench [n ...]   (default 128 256 512 1024 2048)
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "../matrix.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F>
+static double bestOf(int repetitions, F&& run) {
+    double best = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+        auto start = Clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    return best;
+}
+
+// max |(A B - I)(i, j)|, computed with Eigen for both
+static double inverseError(const Eigen::MatrixXd& a, const Eigen::MatrixXd& inv) {
+    return (a * inv - Eigen::MatrixXd::Identity(a.rows(), a.cols())).cwiseAbs().maxCoeff();
+}
+
+static void run(size_t n) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix<double> a(n, n);
+    Eigen::MatrixXd e(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a(i, j) = e(i, j) = dist(gen);
+        }
+    }
+    int repetitions = n <= 512 ? 10 : 3;
+
+    double ours = bestOf(repetitions, [&] { LUDecomposition<double> lu(a); });
+    double eigen = bestOf(repetitions, [&] { Eigen::PartialPivLU<Eigen::MatrixXd> lu(e); });
+
+    double det = 0, eigenDet = 0;
+    double oursDet = bestOf(repetitions, [&] { det = a.determinant(); });
+    double eigenDetTime = bestOf(repetitions, [&] { eigenDet = e.partialPivLu().determinant(); });
+
+    Matrix<double> inv;
+    Eigen::MatrixXd eigenInv;
+    double oursInv = bestOf(repetitions, [&] { inv = a.inverse(); });
+    double eigenInvTime = bestOf(repetitions, [&] { eigenInv = e.partialPivLu().inverse(); });
+
+    // Residual of P A = L U
+    LUDecomposition<double> lu(a);
+    Eigen::MatrixXd packed(n, n), pa = e;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            packed(i, j) = lu.factors()(i, j);
+        }
+        pa.row(i).swap(pa.row(lu.pivots()[i]));
+    }
+    Eigen::MatrixXd lower = packed.triangularView<Eigen::UnitLower>();
+    Eigen::MatrixXd upper = packed.triangularView<Eigen::Upper>();
+    double residual = (pa - lower * upper).cwiseAbs().maxCoeff() / e.cwiseAbs().maxCoeff();
+
+    Eigen::MatrixXd oursInvE(n, n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            oursInvE(i, j) = inv(i, j);
+        }
+    }
+
+    std::printf("n=%5zu  lu %.4fs (eigen %.4fs, %.2fx)  det %.4fs (%.2fx)  inverse %.4fs (eigen %.4fs, %.2fx)\n", n,
+                ours, eigen, ours / eigen, oursDet, oursDet / eigenDetTime, oursInv, eigenInvTime,
+                oursInv / eigenInvTime);
+    // Large random determinants overflow in both
+    double detDiff = std::isfinite(eigenDet) ? std::abs(det - eigenDet) / std::abs(eigenDet) : 0.0;
+    std::printf("        residual %.2e  det rel diff %.2e%s  |A A^-1 - I| %.2e (eigen %.2e)\n", residual, detDiff,
+                std::isfinite(eigenDet) ? "" : " (overflow)", inverseError(e, oursInvE), inverseError(e, eigenInv));
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {128, 256, 512, 1024, 2048};
+    if (argc > 1) {
+        sizes.clear();
+        for (int i = 1; i < argc; i++) {
+            sizes.push_back(std::strtoul(argv[i], nullptr, 10));
+        }
+    }
+    for (size_t n : sizes) {
+        run(n);
+    }
+    return 0;
+}
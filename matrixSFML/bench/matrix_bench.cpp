@@ -0,0 +1,200 @@
+// Times the core Matrix<T> operations for float and double on square
+// sizes from 2x2 to 4096x4096: construction, copy, operator+, operator*,
+// projection of n x 1 vectors, and each transform class applied to the
+// same number of elements as 2D points (a 2 x n*n/2 matrix). Reports
+// ns/op, GFLOP/s and heap bytes and allocations per op, as a table or,
+// with --json, as one JSON document for comparing runs:
+//
+//     matrix_bench [--json] [--max N] [--min-time SECONDS]
+//
+// Each operation is repeated in batches of at least --min-time (0.05 s by
+// default) after a warm-up, and the fastest batch is reported. GFLOP/s
+// counts the nominal 2n^3 of a product, also where Strassen does fewer.
+// Needs no display and no SFML.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../matrix.hpp"
+#include "counting_allocator.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+    const char* op;
+    const char* type;
+    size_t rows, cols;
+    size_t iterations;
+    double ns;          // per op, fastest batch
+    double flops;       // per op, 0 where it doesn't apply
+    double bytes;       // heap bytes allocated per op
+    double allocations; // heap allocations per op
+};
+
+static double minTime = 0.05;
+
+// Runs op in batches of at least minTime, after one warm-up call
+template <typename F>
+static Result measure(const char* name, const char* type, size_t rows, size_t cols, double flops, F&& op) {
+    auto start = Clock::now();
+    op();
+    double once = std::chrono::duration<double>(Clock::now() - start).count();
+    size_t iterations = once >= minTime ? 1 : static_cast<size_t>(minTime / std::max(once, 1e-9)) + 1;
+    int batches = once >= 1.0 ? 1 : 3;
+
+    double best = 1e30;
+    size_t allocationsBefore = counting::allocations(), bytesBefore = counting::bytes();
+    for (int b = 0; b < batches; b++) {
+        start = Clock::now();
+        for (size_t i = 0; i < iterations; i++) {
+            op();
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations);
+    }
+    double runs = static_cast<double>(iterations) * batches;
+    return Result{name, type, rows, cols, iterations, best, flops,
+                  static_cast<double>(counting::bytes() - bytesBefore) / runs,
+                  static_cast<double>(counting::allocations() - allocationsBefore) / runs};
+}
+
+template <typename T>
+static Matrix<T> randomMatrix(size_t m, size_t n, std::mt19937& gen) {
+    std::uniform_real_distribution<T> dist(-1, 1);
+    Matrix<T> a(m, n);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a(i, j) = dist(gen);
+        }
+    }
+    return a;
+}
+
+// Keeps results alive so the compiler can't drop the work
+static volatile double sink = 0;
+
+template <typename T>
+static void run(const char* type, size_t n, std::vector<Result>& results) {
+    std::mt19937 gen(42);
+    Matrix<T> a = randomMatrix<T>(n, n, gen);
+    Matrix<T> b = randomMatrix<T>(n, n, gen);
+    Matrix<T> u = randomMatrix<T>(n, 1, gen);
+    Matrix<T> v = randomMatrix<T>(n, 1, gen);
+    size_t count = std::max<size_t>(n * n / 2, 1);
+    Matrix<T> points = randomMatrix<T>(2, count, gen);
+    double nn = static_cast<double>(n) * n;
+
+    // A new matrix holds no values yet, so keep its address instead
+    results.push_back(measure("construct", type, n, n, 0, [&] {
+        Matrix<T> c(n, n);
+        sink = sink + static_cast<double>(reinterpret_cast<uintptr_t>(c.data()) & 1);
+    }));
+    results.push_back(measure("copy", type, n, n, 0, [&] {
+        Matrix<T> c(a);
+        sink = sink + c(0, 0);
+    }));
+    results.push_back(measure("add", type, n, n, nn, [&] {
+        Matrix<T> c = a + b;
+        sink = sink + c(0, 0);
+    }));
+    results.push_back(measure("multiply", type, n, n, 2 * nn * n, [&] {
+        Matrix<T> c = a * b;
+        sink = sink + c(0, 0);
+    }));
+    // Two dot products and the scaling of v
+    results.push_back(measure("projection", type, n, 1, 5.0 * n, [&] {
+        Matrix<T> p = Matrix<T>::projection(u, v);
+        sink = sink + p(0, 0);
+    }));
+
+    // Each transform is built and applied to count 2D points
+    double pointFlops = 8.0 * count;
+    results.push_back(measure("rotate", type, 2, count, pointFlops, [&] {
+        Matrix<T> p = RotateMatrix<T>(T(30)) * points;
+        sink = sink + p(0, 0);
+    }));
+    results.push_back(measure("shear", type, 2, count, pointFlops, [&] {
+        Matrix<T> p = ShearMatrix<T>(2, 2, T(0.5), T(0)) * points;
+        sink = sink + p(0, 0);
+    }));
+    results.push_back(measure("scale", type, 2, count, pointFlops, [&] {
+        Matrix<T> p = ScaleMatrix<T>(2, 2, T(2), T(3)) * points;
+        sink = sink + p(0, 0);
+    }));
+    results.push_back(measure("reflect", type, 2, count, pointFlops, [&] {
+        Matrix<T> p = ReflectMatrix<T>(2, 2, true, false) * points;
+        sink = sink + p(0, 0);
+    }));
+}
+
+static void printTable(const std::vector<Result>& results) {
+    std::printf("%-11s %-6s %12s %14s %10s %14s %8s\n", "op", "type", "shape", "ns/op", "GFLOP/s", "bytes/op",
+                "allocs");
+    for (const Result& r : results) {
+        std::string shape = std::to_string(r.rows) + "x" + std::to_string(r.cols);
+        std::printf("%-11s %-6s %12s %14.1f ", r.op, r.type, shape.c_str(), r.ns);
+        if (r.flops > 0) {
+            std::printf("%10.2f ", r.flops / r.ns);
+        } else {
+            std::printf("%10s ", "-");
+        }
+        std::printf("%14.0f %8.1f\n", r.bytes, r.allocations);
+    }
+}
+
+static void printJson(const std::vector<Result>& results) {
+    std::printf("{\n  \"isa\": \"%s\",\n  \"threads\": %zu,\n  \"inline_capacity\": %d,\n  \"results\": [\n",
+                simd::isaName(simd::activeIsa()), parallel::threadCount(), MATRIX_INLINE_CAPACITY);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        std::printf("    {\"op\": \"%s\", \"type\": \"%s\", \"rows\": %zu, \"cols\": %zu, \"iterations\": %zu, "
+                    "\"ns_per_op\": %.3f, ",
+                    r.op, r.type, r.rows, r.cols, r.iterations, r.ns);
+        if (r.flops > 0) {
+            std::printf("\"gflops\": %.4f, ", r.flops / r.ns);
+        } else {
+            std::printf("\"gflops\": null, ");
+        }
+        std::printf("\"bytes_per_op\": %.1f, \"allocs_per_op\": %.2f}%s\n", r.bytes, r.allocations,
+                    i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    size_t maxSize = 4096;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc) {
+            maxSize = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+            minTime = std::strtod(argv[++i], nullptr);
+        } else {
+            std::fprintf(stderr, "usage: %s [--json] [--max N] [--min-time SECONDS]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    for (size_t n = 2; n <= maxSize; n *= 2) {
+        run<float>("float", n, results);
+        run<double>("double", n, results);
+        if (!json) {
+            std::fprintf(stderr, "%zux%zu done\n", n, n);
+        }
+    }
+
+    if (json) {
+        printJson(results);
+    } else {
+        printTable(results);
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Times the visualizer's operation mix on runtime-sized matrices: 2x1
+// vectors pushed through 2x2 rotate/shear/scale/reflect transforms, vector
+// addition, subtraction and projection, plus 3x3 and 4x4 products.
+//
+// Built twice: sbo_bench with the default inline storage and
+// sbo_bench_heap with MATRIX_INLINE_CAPACITY=0, so running both shows what
+// keeping small matrices inline saves.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../matrix.hpp"
+#include "counting_allocator.hpp"
+
+static Matrix<float> vectorToMatrix(float x, float y) {
+    Matrix<float> mat(2, 1);
+    mat(0, 0) = x;
+    mat(1, 0) = y;
+    return mat;
+}
+
+// One pass through every handler in main.cpp, in runtime-sized form
+static float operationMix(float t) {
+    Matrix<float> v1 = vectorToMatrix(t, 1.5f);
+    Matrix<float> v2 = vectorToMatrix(-0.5f, t);
+
+    RotateMatrix<float> rotMat(t);
+    Matrix<float> rotated = rotMat * v1;
+
+    ShearMatrix<float> shearMat(2, 2, 0.5f, t);
+    Matrix<float> sheared = shearMat * v1;
+
+    ScaleMatrix<float> scaleMat(2, 2, t, 2.0f);
+    Matrix<float> scaled = scaleMat * v1;
+
+    Matrix<float> sum = v1 + v2;
+    Matrix<float> difference = v1 - v2;
+    Matrix<float> projected = Matrix<float>::projection(v1, v2);
+
+    ReflectMatrix<float> reflectMat(2, 2, true, true);
+    RotateMatrix<float> quarterTurn(90);
+    Matrix<float> reflected = quarterTurn * reflectMat * v1;
+
+    ShearMatrix<float> shear3(3, 3, t, 0.25f);
+    Matrix<float> product3 = shear3 * shear3;
+    ScaleMatrix<float> scale4(4, 4, t, 3.0f);
+    Matrix<float> product4 = scale4 * scale4;
+
+    return rotated(0, 0) + sheared(1, 0) + scaled(0, 0) + sum(1, 0) + difference(0, 0)
+         + projected(1, 0) + reflected(0, 0) + product3(2, 2) + product4(1, 1);
+}
+
+int main(int argc, char** argv) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    volatile float sink = 0;
+    size_t allocationsBefore = counting::allocations();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        sink = sink + operationMix(static_cast<float>(i % 360));
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count() / iterations;
+    double allocations = static_cast<double>(counting::allocations() - allocationsBefore) / iterations;
+    std::printf("inline capacity %d: %.1f ns per mix, %.1f heap allocations per mix\n",
+                MATRIX_INLINE_CAPACITY, ns, allocations);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#ifndef BLAS_HPP
+#define BLAS_HPP
+
+#include <stdexcept>
+#include <type_traits>
+
+#include "matrix.hpp"
+#include "simd.hpp"
+
+// BLAS-style fused updates that write into a destination the caller owns,
+// so an iteration that keeps its matrices around runs without allocating:
+//
+//     Matrix<double> r(n, 1), x(n, 1);
+//     for (...) {
+//         blas::gemv(-1.0, a, x, 1.0, r); // r -= A x
+//         blas::axpy(step, r, x);         // x += step r
+//     }
+//
+// Operands are matrices or views, so a.transpose() or c.block(...) works
+// on a transpose or on part of a matrix without copying. The destination
+// must already have the right shape; it is never resized. As in BLAS, a
+// beta of 0 ignores what the destination held.
+namespace blas {
+
+template <typename M>
+using Scalar = typename std::decay_t<M>::value_type;
+
+// y += alpha * x
+template <typename X, typename Y>
+void axpy(Scalar<Y> alpha, const X& x, Y&& y);
+
+// y = alpha * A * x + beta * y, for column vectors x and y
+template <typename A, typename X, typename Y>
+void gemv(Scalar<Y> alpha, const A& a, const X& x, Scalar<Y> beta, Y&& y);
+
+// C = alpha * A * B + beta * C
+template <typename A, typename B, typename C>
+void gemm(Scalar<C> alpha, const A& a, const B& b, Scalar<C> beta, C&& c);
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename X, typename Y>
+void axpy(Scalar<Y> alpha, const X& x, Y&& y) {
+    auto src = ::detail::constView(x);
+    auto dst = ::detail::writableView(y);
+    if (src.getRows() != dst.getRows() || src.getCols() != dst.getCols()) {
+        throw runtime_error("Error: Matrix sizes do not match for axpy!");
+    }
+    // x read through a different layout of y's memory is copied out first
+    if (::detail::conflicts(src, ::detail::constView(dst))) {
+        Matrix<Scalar<Y>> copy(src);
+        ::detail::axpyElements(alpha, ::detail::constView(copy), dst);
+        return;
+    }
+    ::detail::axpyElements(alpha, src, dst);
+}
+
+template <typename A, typename X, typename Y>
+void gemv(Scalar<Y> alpha, const A& a, const X& x, Scalar<Y> beta, Y&& y) {
+    using T = Scalar<Y>;
+    auto mat = ::detail::constView(a);
+    auto vec = ::detail::constView(x);
+    auto dst = ::detail::writableView(y);
+    if (vec.getCols() != 1 || dst.getCols() != 1 || mat.getCols() != vec.getRows() ||
+        mat.getRows() != dst.getRows()) {
+        throw runtime_error("Error: Matrix sizes do not match for gemv!");
+    }
+    // y is written while A and x are still being read
+    if (::detail::overlaps(mat, dst) || ::detail::overlaps(vec, dst)) {
+        Matrix<T> result(dst);
+        gemv(alpha, mat, vec, beta, result);
+        ::detail::copyElements(::detail::constView(result), dst);
+        return;
+    }
+
+    // A wider accumulation mode is applied by the product kernel, for
+    // any layout
+    if (!simd::nativeAccumulation<T>()) {
+        gemm(alpha, mat, vec, beta, dst);
+        return;
+    }
+
+    size_t m = mat.getRows(), n = mat.getCols();
+    ::detail::forRowBands(m, m * n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            dst(i, 0) = beta == T(0) ? T(0) : beta * dst(i, 0);
+        }
+        if (mat.getColStride() == 1 && vec.getStride() == 1) {
+            // Rows of A are contiguous: one dot product per element of y
+            for (size_t i = begin; i < end; i++) {
+                dst(i, 0) += alpha * simd::dot(&mat(i, 0), vec.data(), n);
+            }
+        } else if (mat.getStride() == 1 && dst.getStride() == 1) {
+            // Columns are, as in a transposed view: add them into y in turn
+            for (size_t j = 0; j < n; j++) {
+                simd::axpy(alpha * vec(j, 0), &mat(begin, j), &dst(begin, 0), end - begin);
+            }
+        } else {
+            for (size_t i = begin; i < end; i++) {
+                T sum = 0;
+                for (size_t j = 0; j < n; j++) {
+                    sum += mat(i, j) * vec(j, 0);
+                }
+                dst(i, 0) += alpha * sum;
+            }
+        }
+    });
+}
+
+template <typename A, typename B, typename C>
+void gemm(Scalar<C> alpha, const A& a, const B& b, Scalar<C> beta, C&& c) {
+    auto left = ::detail::constView(a);
+    auto right = ::detail::constView(b);
+    auto dst = ::detail::writableView(c);
+    if (left.getCols() != right.getRows() || left.getRows() != dst.getRows() ||
+        right.getCols() != dst.getCols()) {
+        throw runtime_error("Error: Matrix sizes do not match for gemm!");
+    }
+    // The kernels store whole rows of C and must not read what they write
+    if (dst.getColStride() != 1 || ::detail::overlaps(left, dst) || ::detail::overlaps(right, dst)) {
+        Matrix<Scalar<C>> result(dst);
+        gemm(alpha, left, right, beta, result);
+        ::detail::copyElements(::detail::constView(result), dst);
+        return;
+    }
+    ::detail::multiplyInto(left, right, dst.data(), dst.getStride(), alpha, beta);
+}
+
+} // namespace blas
+
+#endif // BLAS_HPP
@@ -0,0 +1,153 @@
+#ifndef EIGEN_INTEROP_HPP
+#define EIGEN_INTEROP_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <stdexcept>
+#include <type_traits>
+
+#include <Eigen/Core>
+
+#include "matrix.hpp"
+
+// Zero-copy adapters between Matrix<T> and Eigen dense objects. Each side
+// sees the other's elements in place, with the other's strides:
+//
+//     Matrix<double> a(n, n);
+//     matrix_eigen::asEigen(a) = Eigen::MatrixXd::Random(n, n); // writes into a
+//
+//     Eigen::MatrixXd e = ...;
+//     Matrix<double> b = other * matrix_eigen::asView(e);      // reads e
+//
+//     matrix_eigen::RowMajorMatrix<double> r = ...;             // Eigen, row-major
+//     LUDecomposition<double> lu(matrix_eigen::asMatrix(r));   // factors r in place
+//
+// asEigen gives an Eigen::Map of a Matrix<T> or MatrixView<T>. The maps
+// claim no alignment: heap buffers of Matrix<T> are cache-line aligned, but
+// small matrices keep their elements inline and views start anywhere.
+//
+// asView gives a MatrixView of any Eigen object with direct access to its
+// elements (matrices, maps, blocks, transposes), row- or column-major, and
+// asMatrix a Matrix<T> that uses its elements as its buffer, for the code
+// that takes a Matrix<T>, such as the transforms and LUDecomposition. A
+// Matrix<T> is row-major, so asMatrix needs contiguous rows: a row-major
+// Eigen matrix, a column vector, or the transpose of a column-major matrix.
+// The borrowed matrix never frees the elements and can't be resized; like
+// a view, it must not outlive the Eigen object. A result of its shape,
+// even one that reads it, is written into the elements, so
+// asMatrix(e) = asMatrix(e) * b updates e. Like any temporary Matrix, a
+// temporary asMatrix(e) operand lends its buffer to the result, so
+// asMatrix(e) + f writes into e too; asView(e) only reads.
+namespace matrix_eigen {
+
+template <typename T>
+using RowMajorMatrix = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+// A map of the rows of a Matrix<T>, stride elements apart
+template <typename T>
+using MatrixMap = Eigen::Map<RowMajorMatrix<T>, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+template <typename T>
+using ConstMatrixMap = Eigen::Map<const RowMajorMatrix<T>, Eigen::Unaligned, Eigen::OuterStride<>>;
+
+// A map of a view, with both its strides; T may be const
+template <typename T>
+using ViewMap = Eigen::Map<std::conditional_t<std::is_const<T>::value, const RowMajorMatrix<std::remove_const_t<T>>,
+                                              RowMajorMatrix<T>>,
+                           Eigen::Unaligned, Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>;
+
+namespace detail {
+
+// The resource of borrowed matrices: there is nothing to free, and a
+// borrowed buffer is never swapped for a new one
+class BorrowedResource : public std::pmr::memory_resource {
+    void* do_allocate(size_t, size_t) override {
+        throw runtime_error("Error: A matrix borrowed from Eigen cannot be resized!");
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+inline std::pmr::memory_resource* borrowedResource() {
+    static BorrowedResource resource;
+    return &resource;
+}
+
+// Element type of an Eigen object, const when it is read-only
+template <typename Derived>
+using Element = std::remove_pointer_t<decltype(std::declval<Derived&>().data())>;
+
+template <typename Derived>
+MatrixView<Element<Derived>> view(Derived& m) {
+    static_assert(Derived::Flags & Eigen::DirectAccessBit, "Error: Only Eigen objects with direct access have a view!");
+    return MatrixView<Element<Derived>>(m.data(), size_t(m.rows()), size_t(m.cols()), size_t(m.rowStride()),
+                                        size_t(m.colStride()));
+}
+
+template <typename Derived>
+Matrix<Element<Derived>> borrow(Derived& m) {
+    using T = Element<Derived>;
+    static_assert(!std::is_const<T>::value, "Error: Cannot borrow a read-only Eigen object as a Matrix!");
+    MatrixView<T> v = view(m);
+    if (v.getRows() == 0 || v.getCols() == 0) {
+        return Matrix<T>(borrowedResource());
+    }
+    // A single column has no column stride to speak of
+    if (v.getColStride() != 1 && v.getCols() > 1) {
+        throw runtime_error("Error: Only Eigen objects with contiguous rows can be borrowed as a Matrix!");
+    }
+    return Matrix<T>(v.getRows(), v.getCols(), v.getStride(), v.data(), borrowedResource());
+}
+
+} // namespace detail
+
+// Eigen maps of Matrix<T> and its views
+template <typename T>
+MatrixMap<T> asEigen(Matrix<T>& m) {
+    return MatrixMap<T>(m.data(), m.getRows(), m.getCols(), Eigen::OuterStride<>(m.getStride()));
+}
+
+template <typename T>
+ConstMatrixMap<T> asEigen(const Matrix<T>& m) {
+    return ConstMatrixMap<T>(m.data(), m.getRows(), m.getCols(), Eigen::OuterStride<>(m.getStride()));
+}
+
+template <typename T>
+ViewMap<T> asEigen(const MatrixView<T>& v) {
+    return ViewMap<T>(v.data(), v.getRows(), v.getCols(),
+                      Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>(v.getStride(), v.getColStride()));
+}
+
+// Views of Eigen objects. Temporaries such as e.block(...) or
+// e.transpose() view the elements of e.
+template <typename Derived>
+auto asView(Eigen::DenseBase<Derived>& m) {
+    return detail::view(m.derived());
+}
+
+template <typename Derived>
+auto asView(const Eigen::DenseBase<Derived>& m) {
+    return detail::view(m.derived());
+}
+
+template <typename Derived>
+auto asView(Eigen::DenseBase<Derived>&& m) {
+    return detail::view(m.derived());
+}
+
+// Matrices whose buffer is the elements of an Eigen object
+template <typename Derived>
+auto asMatrix(Eigen::DenseBase<Derived>& m) {
+    return detail::borrow(m.derived());
+}
+
+template <typename Derived>
+auto asMatrix(Eigen::DenseBase<Derived>&& m) {
+    return detail::borrow(m.derived());
+}
+
+} // namespace matrix_eigen
+
+#endif // EIGEN_INTEROP_HPP
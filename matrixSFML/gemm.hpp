@@ -0,0 +1,494 @@
+#ifndef GEMM_HPP
+#define GEMM_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <type_traits>
+#include <vector>
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// General matrix multiply on raw row-major buffers: C = A * B, where A is
+// m x k, B is k x n and C is m x n, each with its own row stride;
+// multiplyAdd() is the general C = alpha * A * B + beta * C. A and B
+// also take a column stride (rsa/csa, rsb/csb), so a transposed or other
+// strided view is read in place; the packing step absorbs the layout.
+//
+// Large products follow the usual packed layout: B is copied one KC x NC
+// block at a time into NR-wide column panels, A one MC x KC block at a time
+// into MR-tall row panels, and a micro-kernel keeps an MR x NR tile of C in
+// registers while it walks the shared KC dimension. The A block stays in L2
+// and each B panel in L1, so every element that the kernel loads is reused
+// from cache. Small products skip the packing and use the plain loop.
+//
+// The micro-kernels live in simd.hpp; each instruction set brings its own
+// tile shape, and multiply() packs for whichever one is active.
+//
+// Under simd::Accumulation::Double, float products are packed into double
+// panels and run through the double kernel, then rounded into C once;
+// under Compensated every element of C is a compensated dot product. See
+// simd::setAccumulation().
+//
+// Large products are spread over the thread pool. Every element of C is
+// still summed by one kernel call per KC slice, in the same order, so the
+// result does not depend on the number of threads.
+namespace gemm {
+
+// Cache blocking shared by all micro-kernels. MC is rounded down to a
+// multiple of the kernel's MR.
+template <typename T>
+struct Blocking {
+    static constexpr size_t KC = 256;  // depth of a packed panel
+    static constexpr size_t MC = 120;  // rows of A kept in L2
+    static constexpr size_t NC = 2048; // columns of B packed at once
+};
+
+// Products with fewer multiply-adds than this aren't worth packing
+constexpr size_t naiveLimit = 48 * 48 * 48;
+
+// C = alpha * A * B, or C += alpha * A * B when accumulating
+template <typename T>
+void naiveMultiply(size_t m, size_t n, size_t k, T alpha,
+                   const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                   T* c, size_t ldc, bool accumulate) {
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            T sum = 0;
+            for (size_t p = 0; p < k; p++) {
+                sum += a[i * rsa + p * csa] * b[p * rsb + j * csb];
+            }
+            c[i * ldc + j] = accumulate ? c[i * ldc + j] + alpha * sum : alpha * sum;
+        }
+    }
+}
+
+// Copies an mc x kc block of alpha * A into MR-row panels, column by
+// column. The last panel is zero padded so the kernel never needs an edge
+// case; scaling here costs one multiply per element of A rather than of C.
+// The panels may be of a wider type P than A.
+template <size_t MR, typename T, typename P>
+void packA(size_t mc, size_t kc, P alpha, const T* a, size_t rsa, size_t csa, P* packed) {
+    for (size_t i = 0; i < mc; i += MR) {
+        size_t mr = std::min(MR, mc - i);
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t r = 0; r < mr; r++) {
+                packed[r] = alpha * P(a[(i + r) * rsa + p * csa]);
+            }
+            for (size_t r = mr; r < MR; r++) {
+                packed[r] = 0;
+            }
+            packed += MR;
+        }
+    }
+}
+
+// Copies a kc x nc block of B into NR-column panels, row by row
+template <size_t NR, typename T, typename P>
+void packB(size_t kc, size_t nc, const T* b, size_t rsb, size_t csb, P* packed) {
+    for (size_t j = 0; j < nc; j += NR) {
+        size_t nr = std::min(NR, nc - j);
+        for (size_t p = 0; p < kc; p++) {
+            const T* row = b + p * rsb + j * csb;
+            if (csb == 1) {
+                std::copy_n(row, nr, packed);
+            } else {
+                for (size_t c = 0; c < nr; c++) {
+                    packed[c] = P(row[c * csb]);
+                }
+            }
+            for (size_t c = nr; c < NR; c++) {
+                packed[c] = 0;
+            }
+            packed += NR;
+        }
+    }
+}
+
+// Packing space, kept per thread and grown to the largest product seen, so
+// that repeated products of similar sizes don't allocate. Slot 0 holds A,
+// slot 1 holds B and slot 2 the sums of a widened product.
+//
+// A thread waiting in parallelFor runs queued tasks, which may belong to
+// another product and pack on this thread while the pool still reads the
+// panels of its own. So each PackSpace takes the next level of a per-thread
+// stack of buffers and holds it until it goes out of scope.
+template <typename T>
+class PackSpace {
+public:
+    PackSpace() : level(claim()) {}
+    ~PackSpace() { depth()--; }
+
+    PackSpace(const PackSpace&) = delete;
+    PackSpace& operator=(const PackSpace&) = delete;
+
+    T* buffer(size_t slot, size_t size) {
+        std::vector<T>& buffer = level[slot];
+        if (buffer.size() < size) {
+            buffer.resize(size);
+        }
+        return buffer.data();
+    }
+
+private:
+    using Level = std::array<std::vector<T>, 3>;
+
+    Level& level;
+
+    static size_t& depth() {
+        thread_local size_t levelsInUse = 0;
+        return levelsInUse;
+    }
+
+    // A deque, so the levels below never move when one is added
+    static Level& claim() {
+        thread_local std::deque<Level> levels;
+        size_t index = depth()++;
+        if (index == levels.size()) {
+            levels.emplace_back();
+        }
+        return levels[index];
+    }
+};
+
+template <typename T, typename Kernel>
+void blockedMultiply(size_t m, size_t n, size_t k, T alpha,
+                     const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                     T* c, size_t ldc, bool accumulate) {
+    constexpr size_t MR = Kernel::MR;
+    constexpr size_t NR = Kernel::NR;
+    constexpr size_t KC = Blocking<T>::KC;
+    constexpr size_t MC = Blocking<T>::MC / MR * MR;
+    constexpr size_t NC = Blocking<T>::NC / NR * NR;
+    auto roundUp = [](size_t x, size_t to) { return (x + to - 1) / to * to; };
+
+    size_t ncMax = std::min(NC, roundUp(n, NR));
+    size_t kcMax = std::min(KC, k);
+    size_t mcMax = std::min(MC, roundUp(m, MR));
+    PackSpace<T> space;
+    T* packedA = space.buffer(0, mcMax * kcMax);
+    T* packedB = space.buffer(1, kcMax * ncMax);
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            // Unless C is being accumulated into, the first slice of the
+            // shared dimension overwrites it and the rest add to it
+            bool add = accumulate || pc > 0;
+            packB<NR>(kc, nc, b + pc * rsb + jc * csb, rsb, csb, packedB);
+
+            for (size_t ic = 0; ic < m; ic += MC) {
+                size_t mc = std::min(MC, m - ic);
+                packA<MR>(mc, kc, alpha, a + ic * rsa + pc * csa, rsa, csa, packedA);
+
+                for (size_t jr = 0; jr < nc; jr += NR) {
+                    size_t nr = std::min(NR, nc - jr);
+                    const T* bPanel = packedB + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += MR) {
+                        size_t mr = std::min(MR, mc - ir);
+                        Kernel::run(kc, packedA + ir * kc, bPanel,
+                                    c + (ic + ir) * ldc + jc + jr, ldc, mr, nr, add);
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Same blocking as blockedMultiply, with each phase split across the pool:
+// B is packed a group of panels per task, A a block of rows per task, and
+// the kernels run one (row block, panel group) tile of C per task
+template <typename T, typename Kernel>
+void parallelBlockedMultiply(size_t m, size_t n, size_t k, T alpha,
+                             const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                             T* c, size_t ldc, bool accumulate) {
+    constexpr size_t MR = Kernel::MR;
+    constexpr size_t NR = Kernel::NR;
+    constexpr size_t KC = Blocking<T>::KC;
+    constexpr size_t MC = Blocking<T>::MC / MR * MR;
+    constexpr size_t NC = Blocking<T>::NC / NR * NR;
+    auto roundUp = [](size_t x, size_t to) { return (x + to - 1) / to * to; };
+
+    size_t ncMax = std::min(NC, roundUp(n, NR));
+    size_t kcMax = std::min(KC, k);
+    PackSpace<T> space;
+    T* packedA = space.buffer(0, roundUp(m, MR) * kcMax);
+    T* packedB = space.buffer(1, kcMax * ncMax);
+
+    size_t rowBlocks = (m + MC - 1) / MC;
+    size_t threads = parallel::threadCount();
+
+    for (size_t jc = 0; jc < n; jc += NC) {
+        size_t nc = std::min(NC, n - jc);
+        size_t panels = (nc + NR - 1) / NR;
+        // Aim for a few tiles per thread so stealing can balance the load
+        size_t groupPanels = std::max<size_t>(1, rowBlocks * panels / (4 * threads));
+        groupPanels = std::min(groupPanels, panels);
+        size_t groups = (panels + groupPanels - 1) / groupPanels;
+
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            bool add = accumulate || pc > 0;
+
+            parallel::parallelFor(groups, [&](size_t g) {
+                size_t jr = g * groupPanels * NR;
+                size_t width = std::min(groupPanels * NR, nc - jr);
+                packB<NR>(kc, width, b + pc * rsb + (jc + jr) * csb, rsb, csb, packedB + jr * kc);
+            });
+            parallel::parallelFor(rowBlocks, [&](size_t blk) {
+                size_t ic = blk * MC;
+                packA<MR>(std::min(MC, m - ic), kc, alpha, a + ic * rsa + pc * csa, rsa, csa,
+                          packedA + ic * kc);
+            });
+
+            parallel::parallelFor(rowBlocks * groups, [&](size_t tile) {
+                size_t ic = tile / groups * MC;
+                size_t mc = std::min(MC, m - ic);
+                size_t jrBegin = tile % groups * groupPanels * NR;
+                size_t jrEnd = std::min(jrBegin + groupPanels * NR, nc);
+                for (size_t jr = jrBegin; jr < jrEnd; jr += NR) {
+                    size_t nr = std::min(NR, nc - jr);
+                    const T* bPanel = packedB + jr * kc;
+                    for (size_t ir = 0; ir < mc; ir += MR) {
+                        size_t mr = std::min(MR, mc - ir);
+                        Kernel::run(kc, packedA + (ic + ir) * kc, bPanel,
+                                    c + (ic + ir) * ldc + jc + jr, ldc, mr, nr, add);
+                    }
+                }
+            });
+        }
+    }
+}
+
+// Runs the blocked product with the given micro-kernel, on the pool when
+// the product is large enough
+template <typename T, typename Kernel>
+void blockedMultiplyWith(size_t m, size_t n, size_t k, T alpha,
+                         const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                         T* c, size_t ldc, bool accumulate) {
+    if (parallel::worthSplitting(m * n * k, parallel::gemmThreshold)) {
+        parallelBlockedMultiply<T, Kernel>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+    } else {
+        blockedMultiply<T, Kernel>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+    }
+}
+
+// ------------------ ACCUMULATION POLICIES ------------------
+
+// Blocked product with the kernel of the wider type W: each MC x NC tile
+// of C is summed over all of k in a W buffer, from A and B packed into W,
+// and rounded into C once. Tiles are independent, so they are what goes
+// to the pool; each packs its own B panels.
+template <typename T, typename W, typename Kernel>
+void widenedMultiply(size_t m, size_t n, size_t k, T alpha,
+                     const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                     T* c, size_t ldc, bool accumulate) {
+    constexpr size_t MR = Kernel::MR;
+    constexpr size_t NR = Kernel::NR;
+    constexpr size_t KC = Blocking<W>::KC;
+    constexpr size_t MC = Blocking<W>::MC / MR * MR;
+    // Narrow enough that the sums of a tile stay in L2
+    constexpr size_t NC = std::max<size_t>(NR, 256 / NR * NR);
+    auto roundUp = [](size_t x, size_t to) { return (x + to - 1) / to * to; };
+
+    size_t rowBlocks = (m + MC - 1) / MC;
+    size_t colBlocks = (n + NC - 1) / NC;
+    auto tile = [&](size_t t) {
+        size_t ic = t / colBlocks * MC, jc = t % colBlocks * NC;
+        size_t mc = std::min(MC, m - ic), nc = std::min(NC, n - jc);
+        size_t kcMax = std::min(KC, k);
+        PackSpace<W> space;
+        W* packedA = space.buffer(0, roundUp(mc, MR) * kcMax);
+        W* packedB = space.buffer(1, kcMax * roundUp(nc, NR));
+        W* sums = space.buffer(2, mc * nc);
+
+        for (size_t pc = 0; pc < k; pc += KC) {
+            size_t kc = std::min(KC, k - pc);
+            packB<NR>(kc, nc, b + pc * rsb + jc * csb, rsb, csb, packedB);
+            packA<MR>(mc, kc, W(alpha), a + ic * rsa + pc * csa, rsa, csa, packedA);
+            for (size_t jr = 0; jr < nc; jr += NR) {
+                for (size_t ir = 0; ir < mc; ir += MR) {
+                    Kernel::run(kc, packedA + ir * kc, packedB + jr * kc, sums + ir * nc + jr, nc,
+                                std::min(MR, mc - ir), std::min(NR, nc - jr), pc > 0);
+                }
+            }
+        }
+        for (size_t i = 0; i < mc; i++) {
+            T* row = c + (ic + i) * ldc + jc;
+            for (size_t j = 0; j < nc; j++) {
+                row[j] = accumulate ? T(W(row[j]) + sums[i * nc + j]) : T(sums[i * nc + j]);
+            }
+        }
+    };
+
+    size_t tiles = rowBlocks * colBlocks;
+    if (parallel::worthSplitting(m * n * k, parallel::gemmThreshold)) {
+        parallel::parallelFor(tiles, tile);
+    } else {
+        for (size_t t = 0; t < tiles; t++) {
+            tile(t);
+        }
+    }
+}
+
+// Every element of C as one dot product of a row of A and a column of B,
+// through dot(x, y, k). Columns of B are gathered a block at a time so
+// that they are contiguous and stay in L2; strided rows of A are gathered
+// one at a time.
+template <typename T, typename Dot>
+void dotMultiply(size_t m, size_t n, size_t k, T alpha,
+                 const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                 T* c, size_t ldc, bool accumulate, Dot dot) {
+    constexpr size_t blockBytes = 128 * 1024;
+    size_t block = std::min(n, std::max<size_t>(1, blockBytes / (k * sizeof(T))));
+    PackSpace<T> space;
+    T* columns = space.buffer(1, block * k);
+
+    for (size_t jb = 0; jb < n; jb += block) {
+        size_t nb = std::min(block, n - jb);
+        for (size_t p = 0; p < k; p++) {
+            for (size_t j = 0; j < nb; j++) {
+                columns[j * k + p] = b[p * rsb + (jb + j) * csb];
+            }
+        }
+        auto rows = [&](size_t begin, size_t end) {
+            PackSpace<T> rowSpace;
+            T* gathered = csa == 1 ? nullptr : rowSpace.buffer(0, k);
+            for (size_t i = begin; i < end; i++) {
+                const T* row = a + i * rsa;
+                if (gathered) {
+                    for (size_t p = 0; p < k; p++) {
+                        gathered[p] = row[p * csa];
+                    }
+                    row = gathered;
+                }
+                T* out = c + i * ldc + jb;
+                for (size_t j = 0; j < nb; j++) {
+                    // dot may return a wider type; C is rounded once
+                    auto sum = alpha * dot(row, columns + j * k, k);
+                    out[j] = accumulate ? T(out[j] + sum) : T(sum);
+                }
+            }
+        };
+        if (parallel::worthSplitting(m * nb * k, parallel::gemmThreshold)) {
+            size_t bands = std::min(m, 4 * parallel::threadCount());
+            parallel::parallelFor(bands, [&](size_t band) { rows(band * m / bands, (band + 1) * m / bands); });
+        } else {
+            rows(0, m);
+        }
+    }
+}
+
+// Runs the product under the active accumulation mode, if it isn't
+// Native; returns whether it did
+template <typename T>
+bool accumulatedMultiply(size_t m, size_t n, size_t k, T alpha,
+                         const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                         T* c, size_t ldc, bool accumulate) {
+    if constexpr (simd::isVectorizable<T>) {
+        switch (simd::activeAccumulation()) {
+        case simd::Accumulation::Compensated:
+            dotMultiply(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate,
+                        [](const T* x, const T* y, size_t len) { return simd::dotCompensated(x, y, len); });
+            return true;
+        case simd::Accumulation::Double:
+            if constexpr (std::is_same<T, float>::value) {
+                if (m * n * k < naiveLimit) {
+                    dotMultiply(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate,
+                                [](const float* x, const float* y, size_t len) { return simd::dotDouble(x, y, len); });
+                    return true;
+                }
+                switch (simd::activeIsa()) {
+                case simd::Isa::AVX512:
+                    widenedMultiply<T, double, simd::Avx512Gemm<double>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb,
+                                                                        c, ldc, accumulate);
+                    break;
+                case simd::Isa::AVX2:
+                    widenedMultiply<T, double, simd::Avx2Gemm<double>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb,
+                                                                      c, ldc, accumulate);
+                    break;
+                case simd::Isa::Baseline:
+                    widenedMultiply<T, double, simd::BaselineGemm<double>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb,
+                                                                          c, ldc, accumulate);
+                    break;
+                case simd::Isa::Scalar:
+                    widenedMultiply<T, double, simd::ScalarGemm<double>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb,
+                                                                        c, ldc, accumulate);
+                    break;
+                }
+                return true;
+            }
+            return false;
+        case simd::Accumulation::Native: return false;
+        }
+    }
+    return false;
+}
+
+// C = alpha * A * B + beta * C. C must not overlap A or B. As in BLAS, a
+// beta of 0 ignores what C held, NaNs included.
+template <typename T>
+void multiplyAdd(size_t m, size_t n, size_t k, T alpha,
+                 const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb,
+                 T beta, T* c, size_t ldc) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    // Any other beta is applied to C up front; the kernels then add to it
+    if (beta != T(0) && beta != T(1)) {
+        for (size_t i = 0; i < m; i++) {
+            simd::scale(beta, c + i * ldc, n);
+        }
+    }
+    bool accumulate = beta != T(0);
+    if (k == 0 || alpha == T(0)) {
+        if (!accumulate) {
+            for (size_t i = 0; i < m; i++) {
+                std::fill_n(c + i * ldc, n, T(0));
+            }
+        }
+        return;
+    }
+    if (accumulatedMultiply(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate)) {
+        return;
+    }
+    if (m * n * k < naiveLimit) {
+        naiveMultiply(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+        return;
+    }
+    switch (simd::activeIsa()) {
+    case simd::Isa::AVX512:
+        blockedMultiplyWith<T, simd::Avx512Gemm<T>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+        break;
+    case simd::Isa::AVX2:
+        blockedMultiplyWith<T, simd::Avx2Gemm<T>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+        break;
+    case simd::Isa::Baseline:
+        blockedMultiplyWith<T, simd::BaselineGemm<T>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+        break;
+    case simd::Isa::Scalar:
+        blockedMultiplyWith<T, simd::ScalarGemm<T>>(m, n, k, alpha, a, rsa, csa, b, rsb, csb, c, ldc, accumulate);
+        break;
+    }
+}
+
+// C = A * B. C must not overlap A or B.
+template <typename T>
+void multiply(size_t m, size_t n, size_t k,
+              const T* a, size_t rsa, size_t csa, const T* b, size_t rsb, size_t csb, T* c, size_t ldc) {
+    multiplyAdd(m, n, k, T(1), a, rsa, csa, b, rsb, csb, T(0), c, ldc);
+}
+
+// C = A * B for row-major A and B
+template <typename T>
+void multiply(size_t m, size_t n, size_t k,
+              const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc) {
+    multiply(m, n, k, a, lda, size_t(1), b, ldb, size_t(1), c, ldc);
+}
+
+} // namespace gemm
+
+#endif // GEMM_HPP
@@ -0,0 +1,269 @@
+#ifndef INSTRUMENT_HPP
+#define INSTRUMENT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <mutex>
+#include <type_traits>
+#include <typeinfo>
+
+// Opt-in counters of what Matrix<T> does with its elements: constructions,
+// copies and moves, and the buffers it takes from its memory resource. They
+// are kept per element type and are off unless the program is built with
+//
+//     -DMATRIX_INSTRUMENT=1
+//
+// Off, the hooks in Matrix<T> are empty and compile to nothing, and the
+// query functions below report zeros. On, every event is one relaxed
+// atomic increment, so the counts stay right across the thread pool:
+//
+//     instrument::reset<float>();
+//     runFrame();
+//     instrument::Counters c = instrument::counters<float>();
+//     // c.copyConstructions, c.allocations, c.peakLiveBytes, ...
+//
+// instrument::dump() prints every type seen so far; dumpAtExit() arranges
+// for that to happen when the program exits, as does setting the
+// environment variable MATRIX_INSTRUMENT_DUMP in an instrumented build.
+//
+// Fixed-size Matrix<T, R, C> never allocates and isn't counted.
+#ifndef MATRIX_INSTRUMENT
+#define MATRIX_INSTRUMENT 0
+#endif
+
+namespace instrument {
+
+constexpr bool enabled = MATRIX_INSTRUMENT != 0;
+
+struct Counters {
+    size_t constructions = 0; // by any constructor, copies and moves included
+    size_t copyConstructions = 0;
+    size_t copyAssignments = 0;
+    size_t moveConstructions = 0;
+    size_t moveAssignments = 0;
+    size_t allocations = 0;   // buffers from a memory resource; inline storage isn't one
+    size_t deallocations = 0; // of those buffers; adopted ones are handed back, not counted
+    size_t bytesAllocated = 0;
+    size_t liveBytes = 0;     // held by matrices now, adopted buffers included
+    size_t peakLiveBytes = 0;
+};
+
+namespace detail {
+
+// The counters of one element type. Trivially destructible, so they are
+// still there for a dump at exit whenever they were created; the types
+// seen so far are chained from head().
+struct TypeCounters {
+    const char* name;
+    TypeCounters* next;
+    std::atomic<size_t> constructions{0};
+    std::atomic<size_t> copyConstructions{0};
+    std::atomic<size_t> copyAssignments{0};
+    std::atomic<size_t> moveConstructions{0};
+    std::atomic<size_t> moveAssignments{0};
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> deallocations{0};
+    std::atomic<size_t> bytesAllocated{0};
+    std::atomic<size_t> liveBytes{0};
+    std::atomic<size_t> peakLiveBytes{0};
+
+    Counters snapshot() const;
+    void reset();
+};
+
+inline std::atomic<TypeCounters*>& head() {
+    static std::atomic<TypeCounters*> first{nullptr};
+    return first;
+}
+
+template <typename T>
+const char* typeName() {
+    if constexpr (std::is_same<T, float>::value) {
+        return "float";
+    } else if constexpr (std::is_same<T, double>::value) {
+        return "double";
+    } else if constexpr (std::is_same<T, int>::value) {
+        return "int";
+    } else {
+        return typeid(T).name();
+    }
+}
+
+inline void registerCounters(TypeCounters* counters);
+
+template <typename T>
+TypeCounters& countersOf() {
+    static TypeCounters counters{typeName<T>(), nullptr};
+    static bool registered = (registerCounters(&counters), true);
+    (void)registered;
+    return counters;
+}
+
+inline void add(std::atomic<size_t>& counter, size_t n = 1) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+// ------------------ HOOKS ------------------
+
+// Called by Matrix<T>; each is empty unless MATRIX_INSTRUMENT is set
+template <typename T>
+inline void constructed() {
+    if constexpr (enabled) {
+        detail::add(detail::countersOf<T>().constructions);
+    }
+}
+
+template <typename T>
+inline void copyConstructed() {
+    if constexpr (enabled) {
+        detail::add(detail::countersOf<T>().constructions);
+        detail::add(detail::countersOf<T>().copyConstructions);
+    }
+}
+
+template <typename T>
+inline void copyAssigned() {
+    if constexpr (enabled) {
+        detail::add(detail::countersOf<T>().copyAssignments);
+    }
+}
+
+template <typename T>
+inline void moveConstructed() {
+    if constexpr (enabled) {
+        detail::add(detail::countersOf<T>().constructions);
+        detail::add(detail::countersOf<T>().moveConstructions);
+    }
+}
+
+template <typename T>
+inline void moveAssigned() {
+    if constexpr (enabled) {
+        detail::add(detail::countersOf<T>().moveAssignments);
+    }
+}
+
+// A buffer of bytes came to be held by a matrix: allocated from its
+// resource, or adopted from elsewhere
+template <typename T>
+inline void allocated(size_t bytes, bool adopted = false) {
+    if constexpr (enabled) {
+        detail::TypeCounters& c = detail::countersOf<T>();
+        if (!adopted) {
+            detail::add(c.allocations);
+            detail::add(c.bytesAllocated, bytes);
+        }
+        size_t live = c.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        size_t peak = c.peakLiveBytes.load(std::memory_order_relaxed);
+        while (live > peak && !c.peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+// A matrix let go of its buffer; an adopted one wasn't counted as an
+// allocation, so it isn't counted as a deallocation either
+template <typename T>
+inline void released(size_t bytes, bool adopted = false) {
+    if constexpr (enabled) {
+        detail::TypeCounters& c = detail::countersOf<T>();
+        if (!adopted) {
+            detail::add(c.deallocations);
+        }
+        c.liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+    }
+}
+
+// ------------------ QUERIES ------------------
+
+// What Matrix<T> has done since the start or the last reset
+template <typename T>
+Counters counters() {
+    if constexpr (enabled) {
+        return detail::countersOf<T>().snapshot();
+    }
+    return Counters();
+}
+
+// Zeroes the counts of Matrix<T>; bytes still held stay live, and the
+// peak starts again from them
+template <typename T>
+void reset() {
+    if constexpr (enabled) {
+        detail::countersOf<T>().reset();
+    }
+}
+
+inline void resetAll() {
+    for (detail::TypeCounters* c = detail::head().load(); c; c = c->next) {
+        c->reset();
+    }
+}
+
+// One line per element type seen so far
+inline void dump(std::ostream& out = std::cerr) {
+    if (!enabled) {
+        out << "Matrix instrumentation is off; build with MATRIX_INSTRUMENT=1\n";
+        return;
+    }
+    for (detail::TypeCounters* c = detail::head().load(); c; c = c->next) {
+        Counters s = c->snapshot();
+        out << "Matrix<" << c->name << ">: " << s.constructions << " constructed (" << s.copyConstructions
+            << " copies, " << s.moveConstructions << " moves), " << s.copyAssignments << " copy and "
+            << s.moveAssignments << " move assignments, " << s.allocations << " allocations of "
+            << s.bytesAllocated << " bytes, " << s.deallocations << " releases, " << s.liveBytes
+            << " bytes live, " << s.peakLiveBytes << " at peak\n";
+    }
+}
+
+// Calls dump() when the program exits; only the first call does anything
+inline void dumpAtExit() {
+    static std::once_flag once;
+    std::call_once(once, [] { std::atexit([] { dump(); }); });
+}
+
+// ------------------ DEFINITIONS ------------------
+
+namespace detail {
+
+inline Counters TypeCounters::snapshot() const {
+    Counters s;
+    s.constructions = constructions.load(std::memory_order_relaxed);
+    s.copyConstructions = copyConstructions.load(std::memory_order_relaxed);
+    s.copyAssignments = copyAssignments.load(std::memory_order_relaxed);
+    s.moveConstructions = moveConstructions.load(std::memory_order_relaxed);
+    s.moveAssignments = moveAssignments.load(std::memory_order_relaxed);
+    s.allocations = allocations.load(std::memory_order_relaxed);
+    s.deallocations = deallocations.load(std::memory_order_relaxed);
+    s.bytesAllocated = bytesAllocated.load(std::memory_order_relaxed);
+    s.liveBytes = liveBytes.load(std::memory_order_relaxed);
+    s.peakLiveBytes = peakLiveBytes.load(std::memory_order_relaxed);
+    return s;
+}
+
+inline void TypeCounters::reset() {
+    for (std::atomic<size_t>* counter : {&constructions, &copyConstructions, &copyAssignments, &moveConstructions,
+                                         &moveAssignments, &allocations, &deallocations, &bytesAllocated}) {
+        counter->store(0, std::memory_order_relaxed);
+    }
+    peakLiveBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+inline void registerCounters(TypeCounters* counters) {
+    counters->next = head().load();
+    while (!head().compare_exchange_weak(counters->next, counters)) {
+    }
+    if (std::getenv("MATRIX_INSTRUMENT_DUMP")) {
+        dumpAtExit();
+    }
+}
+
+} // namespace detail
+
+} // namespace instrument
+
+#endif // INSTRUMENT_HPP
@@ -0,0 +1,164 @@
+#ifndef LU_HPP
+#define LU_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <cmath>
+
+#include "gemm.hpp"
+#include "simd.hpp"
+
+// LU decomposition with partial pivoting on raw row-major buffers:
+// P A = L U, with L unit lower triangular and U upper triangular, both
+// written over A.
+//
+// The factorization is blocked and right-looking. Each step factors a
+// panel of blockSize columns, solves for the matching block row of U and
+// subtracts the product of the two from the trailing matrix with the
+// packed kernel in gemm.hpp, which is where nearly all the flops go. The
+// panels themselves are factored recursively (halving the columns), so
+// they too spend their time in the product kernel rather than in rank-1
+// updates. The triangular solves are split the same way.
+namespace lu {
+
+// Columns per panel of the right-looking loop
+constexpr size_t blockSize = 128;
+
+// Panels and triangular solves at most this wide, or with at most this
+// many elements, go column by column: packing for the product kernel
+// costs more than it saves on blocks that fit in L2
+constexpr size_t leafSize = 16;
+constexpr size_t unblockedElements = 128 * 128;
+
+// B = L^-1 B for an n x n unit lower triangular L and an n x m B
+template <typename T>
+void solveUnitLower(size_t n, size_t m, const T* l, size_t ldl, T* b, size_t ldb) {
+    if (n <= leafSize || n * m <= unblockedElements) {
+        for (size_t i = 1; i < n; i++) {
+            for (size_t p = 0; p < i; p++) {
+                if (l[i * ldl + p] != T(0)) {
+                    simd::axpy(-l[i * ldl + p], b + p * ldb, b + i * ldb, m);
+                }
+            }
+        }
+        return;
+    }
+    // [L11 0; L21 L22] [X1; X2] = [B1; B2]
+    size_t n1 = n / 2;
+    solveUnitLower(n1, m, l, ldl, b, ldb);
+    gemm::multiplyAdd(n - n1, m, n1, T(-1), l + n1 * ldl, ldl, size_t(1), b, ldb, size_t(1), T(1),
+                      b + n1 * ldb, ldb);
+    solveUnitLower(n - n1, m, l + n1 * ldl + n1, ldl, b + n1 * ldb, ldb);
+}
+
+// B = U^-1 B for an n x n upper triangular U with a nonzero diagonal
+template <typename T>
+void solveUpper(size_t n, size_t m, const T* u, size_t ldu, T* b, size_t ldb) {
+    if (n <= leafSize || n * m <= unblockedElements) {
+        for (size_t i = n; i-- > 0;) {
+            for (size_t p = i + 1; p < n; p++) {
+                if (u[i * ldu + p] != T(0)) {
+                    simd::axpy(-u[i * ldu + p], b + p * ldb, b + i * ldb, m);
+                }
+            }
+            simd::scale(T(1) / u[i * ldu + i], b + i * ldb, m);
+        }
+        return;
+    }
+    // [U11 U12; 0 U22] [X1; X2] = [B1; B2], bottom half first
+    size_t n1 = n / 2;
+    solveUpper(n - n1, m, u + n1 * ldu + n1, ldu, b + n1 * ldb, ldb);
+    gemm::multiplyAdd(n1, m, n - n1, T(-1), u + n1, ldu, size_t(1), b + n1 * ldb, ldb, size_t(1), T(1), b, ldb);
+    solveUpper(n1, m, u, ldu, b, ldb);
+}
+
+// Factors the m x n panel at a (m >= n), column by column. Row i of the
+// whole matrix starts offset elements before row i of the panel and has
+// width elements: interchanges swap whole rows, so the columns on either
+// side of the panel are permuted along with it. pivots[j] is the panel
+// row swapped with row j.
+template <typename T>
+void factorColumns(size_t m, size_t n, T* a, size_t ld, size_t offset, size_t width, size_t* pivots) {
+    using std::abs;
+    for (size_t j = 0; j < n; j++) {
+        size_t pivot = j;
+        auto largest = abs(a[j * ld + j]);
+        for (size_t i = j + 1; i < m; i++) {
+            if (abs(a[i * ld + j]) > largest) {
+                largest = abs(a[i * ld + j]);
+                pivot = i;
+            }
+        }
+        pivots[j] = pivot;
+        if (pivot != j) {
+            std::swap_ranges(a + j * ld - offset, a + j * ld - offset + width, a + pivot * ld - offset);
+        }
+        // A zero column leaves U singular; there is nothing to eliminate
+        T diagonal = a[j * ld + j];
+        if (diagonal == T(0)) {
+            continue;
+        }
+        for (size_t i = j + 1; i < m; i++) {
+            T factor = a[i * ld + j] /= diagonal;
+            if (factor != T(0)) {
+                simd::axpy(-factor, a + j * ld + j + 1, a + i * ld + j + 1, n - j - 1);
+            }
+        }
+    }
+}
+
+// The same, halving the columns: factor the left half, update the right
+// half with it, then factor what is left of the right half
+template <typename T>
+void factorPanel(size_t m, size_t n, T* a, size_t ld, size_t offset, size_t width, size_t* pivots) {
+    if (n <= leafSize || m * n <= unblockedElements) {
+        factorColumns(m, n, a, ld, offset, width, pivots);
+        return;
+    }
+    size_t n1 = n / 2, n2 = n - n1;
+    factorPanel(m, n1, a, ld, offset, width, pivots);
+    solveUnitLower(n1, n2, a, ld, a + n1, ld);
+    gemm::multiplyAdd(m - n1, n2, n1, T(-1), a + n1 * ld, ld, size_t(1), a + n1, ld, size_t(1), T(1),
+                      a + n1 * ld + n1, ld);
+    factorPanel(m - n1, n2, a + n1 * ld + n1, ld, offset + n1, width, pivots + n1);
+    for (size_t j = n1; j < n; j++) {
+        pivots[j] += n1;
+    }
+}
+
+// Factors the n x n matrix a in place; row i was swapped with row
+// pivots[i], in order of i
+template <typename T>
+void factorize(size_t n, T* a, size_t ld, size_t* pivots) {
+    for (size_t k = 0; k < n; k += blockSize) {
+        size_t kb = std::min(blockSize, n - k);
+        factorPanel(n - k, kb, a + k * ld + k, ld, k, n, pivots + k);
+        for (size_t j = k; j < k + kb; j++) {
+            pivots[j] += k;
+        }
+        // U12 = L11^-1 A12, then A22 -= L21 U12
+        size_t rest = n - k - kb;
+        if (rest > 0) {
+            T* a12 = a + k * ld + k + kb;
+            solveUnitLower(kb, rest, a + k * ld + k, ld, a12, ld);
+            gemm::multiplyAdd(rest, rest, kb, T(-1), a + (k + kb) * ld + k, ld, size_t(1), a12, ld, size_t(1),
+                              T(1), a12 + kb * ld, ld);
+        }
+    }
+}
+
+// B = A^-1 B for the n x m B, given the factors and pivots of A
+template <typename T>
+void solve(size_t n, size_t m, const T* lu, size_t ld, const size_t* pivots, T* b, size_t ldb) {
+    for (size_t i = 0; i < n; i++) {
+        if (pivots[i] != i) {
+            std::swap_ranges(b + i * ldb, b + i * ldb + m, b + pivots[i] * ldb);
+        }
+    }
+    solveUnitLower(n, m, lu, ld, b, ldb);
+    solveUpper(n, m, lu, ld, b, ldb);
+}
+
+} // namespace lu
+
+#endif // LU_HPP
@@ -7,6 +7,7 @@
 #include <cmath>
 #include <iomanip>
 #include "matrix.hpp"
+#include "transform2d.hpp"
 
 const int WINDOW_WIDTH = 1200;
 const int WINDOW_HEIGHT = 800;
@@ -405,18 +406,19 @@ sf::Vector2f parseVector(const std::string& input) {
     throw std::runtime_error("Invalid vector format");
 }
 
-Matrix<float> vectorToMatrix(const sf::Vector2f& vec) {
-    Matrix<float> mat(2, 1);
-    mat.setElement(0, 0, vec.x);
-    mat.setElement(1, 0, vec.y);
+// Vectors and transforms are fixed-size 2D matrices, so the handlers below
+// never touch the heap
+using VectorMatrix = Matrix<float, 2, 1>;
+
+VectorMatrix vectorToMatrix(const sf::Vector2f& vec) {
+    VectorMatrix mat;
+    mat(0, 0) = vec.x;
+    mat(1, 0) = vec.y;
     return mat;
 }
 
-sf::Vector2f matrixToVector(const Matrix<float>& mat) {
-    if (mat.getRows() >= 2 && mat.getCols() >= 1) {
-        return {mat.getElement(0, 0), mat.getElement(1, 0)};
-    }
-    throw std::runtime_error("Matrix cannot be converted to vector");
+sf::Vector2f matrixToVector(const VectorMatrix& mat) {
+    return {mat(0, 0), mat(1, 0)};
 }
 
 int main() {
@@ -512,9 +514,9 @@ int main() {
                                 messageHistory.push_back("Rotating vector by " + std::to_string(angle) + " degrees");
                                
                                 // Use the RotateMatrix class from matrix.hpp
-                                RotateMatrix<float> rotMat(angle);
-                                Matrix<float> vecMat = vectorToMatrix(tempVector1);
-                                Matrix<float> result = rotMat * vecMat;
+                                RotateMatrix<float, 2> rotMat(angle);
+                                VectorMatrix vecMat = vectorToMatrix(tempVector1);
+                                VectorMatrix result = rotMat * vecMat;
                                 resultVector = matrixToVector(result);
                                
                                 // Clear previous vectors and add only original and result
@@ -560,9 +562,9 @@ int main() {
                                 messageHistory.push_back("Shearing vector by X:" + roundToString(shx) + " Y:" + roundToString(shy));
                                
                                 // Use the ShearMatrix class from matrix.hpp
-                                ShearMatrix<float> shearMat(2, 2, shx, shy);
-                                Matrix<float> vecMat = vectorToMatrix(tempVector1);
-                                Matrix<float> result = shearMat * vecMat;
+                                ShearMatrix<float, 2> shearMat(shx, shy);
+                                VectorMatrix vecMat = vectorToMatrix(tempVector1);
+                                VectorMatrix result = shearMat * vecMat;
                                 resultVector = matrixToVector(result);
                                
                                 // Clear previous vectors and add only original and result
@@ -608,9 +610,9 @@ int main() {
                                 messageHistory.push_back("Scaling vector by X:" + roundToString(sx) + " Y:" + roundToString(sy));
                                
                                 // Use the ScaleMatrix class from matrix.hpp
-                                ScaleMatrix<float> scaleMat(2, 2, sx, sy);
-                                Matrix<float> vecMat = vectorToMatrix(tempVector1);
-                                Matrix<float> result = scaleMat * vecMat;
+                                ScaleMatrix<float, 2> scaleMat(sx, sy);
+                                VectorMatrix vecMat = vectorToMatrix(tempVector1);
+                                VectorMatrix result = scaleMat * vecMat;
                                 resultVector = matrixToVector(result);
                                
                                 // Clear previous vectors and add only original and result
@@ -654,9 +656,9 @@ int main() {
                             messageHistory.push_back("Second vector: (" + roundToString(tempVector2.x) + "," + roundToString(tempVector2.y) + ")");
                            
                             // Use Matrix addition from matrix.hpp
-                            Matrix<float> mat1 = vectorToMatrix(tempVector1);
-                            Matrix<float> mat2 = vectorToMatrix(tempVector2);
-                            Matrix<float> result = mat1 + mat2;
+                            VectorMatrix mat1 = vectorToMatrix(tempVector1);
+                            VectorMatrix mat2 = vectorToMatrix(tempVector2);
+                            VectorMatrix result = mat1 + mat2;
                             resultVector = matrixToVector(result);
                            
                             messageHistory.push_back("Sum: (" + roundToString(resultVector.x) + "," + roundToString(resultVector.y) + ")");
@@ -703,9 +705,9 @@ int main() {
                             messageHistory.push_back("Second vector: (" + roundToString(tempVector2.x) + "," + roundToString(tempVector2.y) + ")");
                            
                             // Use Matrix subtraction from matrix.hpp
-                            Matrix<float> mat1 = vectorToMatrix(tempVector1);
-                            Matrix<float> mat2 = vectorToMatrix(tempVector2);
-                            Matrix<float> result = mat1 - mat2;
+                            VectorMatrix mat1 = vectorToMatrix(tempVector1);
+                            VectorMatrix mat2 = vectorToMatrix(tempVector2);
+                            VectorMatrix result = mat1 - mat2;
                             resultVector = matrixToVector(result);
                            
                             messageHistory.push_back("Difference: (" + roundToString(resultVector.x) + "," + roundToString(resultVector.y) + ")");
@@ -752,9 +754,9 @@ int main() {
                             messageHistory.push_back("Vector to project: (" + roundToString(tempVector2.x) + "," + roundToString(tempVector2.y) + ")");
                            
                             // Use the projection function from matrix.hpp
-                            Matrix<float> mat1 = vectorToMatrix(tempVector1);
-                            Matrix<float> mat2 = vectorToMatrix(tempVector2);
-                            Matrix<float> result = Matrix<float>::projection(mat1, mat2);
+                            VectorMatrix mat1 = vectorToMatrix(tempVector1);
+                            VectorMatrix mat2 = vectorToMatrix(tempVector2);
+                            VectorMatrix result = VectorMatrix::projection(mat1, mat2);
                             resultVector = matrixToVector(result);
                            
                             messageHistory.push_back("Projection: (" + roundToString(resultVector.x) + "," + roundToString(resultVector.y) + ")");
@@ -831,20 +833,16 @@ int main() {
                                 }
                                
                                 if (choice >= 1 && choice <= 4) {
-                                    // Use the ReflectMatrix class from matrix.hpp
-                                    ReflectMatrix<float> reflectMat(2, 2, reflectX, reflectY);
-                                    Matrix<float> vecMat = vectorToMatrix(tempVector1);
-                                    Matrix<float> result;
+                                    // Build the reflection as one composed transform
+                                    Transform2D<float> reflection;
+                                    reflection.then(ReflectMatrix<float, 2>(reflectX, reflectY));
                                    
                                     if (choice == 4) { // Special case for -XY
                                         // For -XY reflection, we need to rotate by 90 degrees after reflection
-                                        RotateMatrix<float> rotMat(90);
-                                        result = rotMat * reflectMat * vecMat;
-                                    } else {
-                                        result = reflectMat * vecMat;
+                                        reflection.rotate(90);
                                     }
                                    
-                                    resultVector = matrixToVector(result);
+                                    resultVector = matrixToVector(reflection.apply(vectorToMatrix(tempVector1)));
                                    
                                     // Clear previous vectors and add only original and result
                                     vectors.clear();
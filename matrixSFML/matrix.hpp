@@ -4,33 +4,140 @@
 #include <iostream>
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <type_traits>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "arena.hpp"
+#include "gemm.hpp"
+#include "instrument.hpp"
+#include "lu.hpp"
+#include "strassen.hpp"
+#include "thread_pool.hpp"
+#include "transpose.hpp"
 
 using namespace std;
 
 const double PI = 3.14159265358979323846;
 
+// Dimension value selecting the heap-backed, runtime-sized matrix
+constexpr size_t Dynamic = static_cast<size_t>(-1);
+
+// Matrix<T> keeps up to this many elements inside the object itself and
+// only allocates above it. 0 turns the inline storage off.
+#ifndef MATRIX_INLINE_CAPACITY
+#define MATRIX_INLINE_CAPACITY 16
+#endif
+
+// Matrix<T> is sized at runtime; Matrix<T, R, C> is a fixed-size matrix
+// stored inline (see FIXED-SIZE MATRICES below)
+template <typename T, size_t R = Dynamic, size_t C = Dynamic> class Matrix;
+
+// Transforms come in the same two forms: ShearMatrix<T> is a Matrix<T>,
+// ShearMatrix<T, 2> is a Matrix<T, 2, 2>
+template <typename T, size_t N = Dynamic> class ShearMatrix;
+template <typename T, size_t N = Dynamic> class RotateMatrix;
+template <typename T, size_t N = Dynamic> class ScaleMatrix;
+template <typename T, size_t N = Dynamic> class ReflectMatrix;
+
+// Non-owning strided window onto a Matrix<T> (see VIEWS below)
+template <typename T> class MatrixView;
+
+// Base of everything that can appear in a matrix expression. Operators
+// build lightweight expression nodes; the work happens in one fused loop
+// when the expression is assigned to a Matrix.
+template <typename E>
+class MatrixExpr {
+public:
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
 // Template base class
 template <typename T>
-class Matrix {
+class Matrix<T, Dynamic, Dynamic> : public MatrixExpr<Matrix<T>> {
+    template <typename L, typename R> friend class MatrixProduct;
+    template <typename L, typename R, typename Op> friend class MatrixElementwise;
+    template <typename U> friend class MatrixView;
+
 protected:
     size_t rows, cols;
-    T** mat;
+    size_t stride;   // elements between the starts of two consecutive rows
+    size_t capacity; // elements allocated in mat, at least rows * stride
+    T* mat;          // single row-major buffer of rows * stride elements
+    bool adopted;    // mat was handed to us, not allocated (see the adopting constructor)
+
+    // Where mat comes from. Defaults to std::pmr::get_default_resource(),
+    // which is plain new/delete unless the program installs something else.
+    std::pmr::memory_resource* resource;
+
+    // Small matrices (2x1 vectors, 2x2 to 4x4 transforms) live here instead
+    static constexpr size_t inlineCapacity = MATRIX_INLINE_CAPACITY;
+    T local[inlineCapacity > 0 ? inlineCapacity : 1];
 
 public:
     // Default constructor - properly initialize mat to nullptr
-    Matrix() : rows(0), cols(0), mat(nullptr) {}
+    Matrix() : Matrix(std::pmr::get_default_resource()) {}
+
+    // An empty matrix whose buffers will come from resource
+    explicit Matrix(std::pmr::memory_resource* resource)
+    : rows(0), cols(0), stride(0), capacity(0), mat(nullptr), adopted(false), resource(resource) {
+        instrument::constructed<T>();
+    }
    
     // Parameterized constructor
-    Matrix(size_t m, size_t n);
+    Matrix(size_t m, size_t n, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // Adopts data, m rows of stride elements that resource handed out,
+    // without touching it; the matrix gives it back to resource when done.
+    // This is how a matrix comes to live in memory it didn't allocate, such
+    // as the mapped pages of a matrix file (see matrix_file.hpp). A result
+    // of its shape, assigned or moved in, is copied into that memory rather
+    // than replacing it.
+    Matrix(size_t m, size_t n, size_t stride, T* data, std::pmr::memory_resource* resource);
    
-    // Copy constructor (needed to prevent shallow copying)
+    // Copy constructor (needed to prevent shallow copying). Like the std::pmr
+    // containers, the copy allocates from the default resource, so copying
+    // out of a per-frame arena gives a matrix that outlives the frame.
     Matrix(const Matrix<T>& other);
    
-    // Assignment operator
+    // Move constructor - steals the buffer, with its resource, and leaves other empty
+    Matrix(Matrix<T>&& other) noexcept;
+
+    // Evaluates a matrix expression
+    template <typename E>
+    Matrix(const MatrixExpr<E>& expr);
+
+    // Assignment operator. Keeps our resource.
     Matrix<T>& operator=(const Matrix<T>& other);
+
+    // Move assignment operator. Takes over other's buffer and resource,
+    // unless ours is adopted and other has our shape: then it is copied.
+    Matrix<T>& operator=(Matrix<T>&& other) noexcept;
+
+    // Evaluates a matrix expression, reusing our buffer when the shape matches
+    template <typename E>
+    Matrix<T>& operator=(const MatrixExpr<E>& expr);
+
+    // In-place updates. += and -= write into our buffer without allocating,
+    // including m += a * b, which the product kernels accumulate directly.
+    template <typename E>
+    Matrix<T>& operator+=(const MatrixExpr<E>& expr);
+    template <typename E>
+    Matrix<T>& operator-=(const MatrixExpr<E>& expr);
+    Matrix<T>& operator*=(T scalar);
+
+    // this = this * expr. Small products reuse our buffer (see multiply)
+    template <typename E>
+    Matrix<T>& operator*=(const MatrixExpr<E>& expr);
    
     virtual ~Matrix();
 
+    using value_type = T;
+
     void inputMatrix();
     void display() const;
 
@@ -39,18 +146,86 @@ public:
 
     size_t getRows() const;
     size_t getCols() const;
+    size_t getStride() const;
+    std::pmr::memory_resource* getResource() const { return resource; }
+
+    // Unchecked element access, used by the hot loops
+    T& operator()(size_t i, size_t j) { return mat[i * stride + j]; }
+    const T& operator()(size_t i, size_t j) const { return mat[i * stride + j]; }
+
+    T* data() { return mat; }
+    const T* data() const { return mat; }
+
+    // Zero-copy views of part or all of the matrix (see MatrixView). They
+    // are invalidated by anything that reshapes, moves or destroys it.
+    MatrixView<T> block(size_t i, size_t j, size_t r, size_t c);
+    MatrixView<const T> block(size_t i, size_t j, size_t r, size_t c) const;
+    MatrixView<T> row(size_t i);
+    MatrixView<const T> row(size_t i) const;
+    MatrixView<T> col(size_t j);
+    MatrixView<const T> col(size_t j) const;
+    MatrixView<T> transpose();
+    MatrixView<const T> transpose() const;
+
+    // Replaces the matrix with its transpose. Square matrices are transposed
+    // in place; others are copied once into a new buffer.
+    void transposeInPlace();
+
+    // Through an LU decomposition with partial pivoting (see
+    // LUDecomposition). inverse() throws for a singular matrix.
+    T determinant() const;
+    Matrix<T> inverse() const;
+
+    // Product kernel: dst must already be a.rows x b.cols and alias neither operand
+    static void multiply(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& dst);
+
+    // These write the product into the buffer of the temporary operand
+    // when it fits, so chained products don't allocate per step; otherwise
+    // the result comes from the temporary's resource
+    static Matrix<T> multiply(Matrix<T>&& a, const Matrix<T>& b);
+    static Matrix<T> multiply(const Matrix<T>& a, Matrix<T>&& b);
 
-    Matrix<T> operator+(const Matrix<T>& other) const;
-    Matrix<T> operator-(const Matrix<T>& other) const;
-    Matrix<T> operator*(const Matrix<T>& other) const;
-   
     // Vector projection implementation
     static Matrix<T> projection(const Matrix<T>& vec1, const Matrix<T>& vec2);
+
+private:
+    // Largest inner dimension of an in-place product, which also bounds the
+    // result row/column it buffers on the stack
+    static constexpr size_t inPlaceProductLimit = 16;
+
+    // Whether multiply(Matrix&&, b) writes a * b into the buffer of a
+    static bool multipliesInPlace(const Matrix<T>& a, const Matrix<T>& b);
+
+    // Where an expression that reads our own elements is evaluated before
+    // it replaces them. Usually the result becomes our buffer, so it comes
+    // from our resource. An adopted buffer is kept instead: a result of our
+    // shape goes to scratch and is copied back, so a matrix borrowed from
+    // Eigen or mapped from a file keeps writing to that memory.
+    std::pmr::memory_resource* resultResource(size_t m, size_t n) const;
+
+    // Buffers are cache-line aligned, which also suits every vector kernel
+    static constexpr size_t alignment = alignof(T) > 64 ? alignof(T) : 64;
+
+    // Gets count elements, from the inline storage when they fit and from
+    // our resource otherwise; they are zeroed when asked to or when T needs
+    // constructing
+    T* allocate(size_t count, bool zeroed);
+
+    // Hands mat back to our resource
+    void release() noexcept;
+
+    bool isInline() const { return mat == local; }
+
+    // Takes over other's elements, moving them across if they are inline
+    void steal(Matrix<T>& other) noexcept;
+
+    // Gives the matrix an m x n shape without preserving the contents
+    void reshape(size_t m, size_t n);
 };
 
 // Shearing
 template <typename T>
-class ShearMatrix : public Matrix<T> {
+class ShearMatrix<T, Dynamic> : public Matrix<T> {
 public:
     // Default constructor
     ShearMatrix() : Matrix<T>() {}
@@ -61,7 +236,7 @@ public:
 
 // Rotation
 template <typename T>
-class RotateMatrix : public Matrix<T> {
+class RotateMatrix<T, Dynamic> : public Matrix<T> {
 public:
     // Default constructor
     RotateMatrix() : Matrix<T>() {}
@@ -72,7 +247,7 @@ public:
 
 // Scaling
 template <typename T>
-class ScaleMatrix : public Matrix<T> {
+class ScaleMatrix<T, Dynamic> : public Matrix<T> {
 public:
     // Default constructor
     ScaleMatrix() : Matrix<T>() {}
@@ -81,84 +256,927 @@ public:
     void transform();
 };
 
-// Reflection
+// Reflection
+template <typename T>
+class ReflectMatrix<T, Dynamic> : public Matrix<T> {
+public:
+    // Default constructor
+    ReflectMatrix() : Matrix<T>() {}
+   
+    ReflectMatrix(size_t m, size_t n, bool reflectX, bool reflectY);
+    void transform();
+};
+
+
+// ------------------ VIEWS ------------------
+
+// A window onto elements of a Matrix<T> that neither owns nor copies them:
+// a block, a row, a column, or the transpose, which only swaps the two
+// strides. A view is a pointer and four sizes, so it is passed by value and
+// never allocates.
+//
+//     a.block(0, 0, 2, 2) = b * c.transpose(); // writes into a
+//     Matrix<float> r = a.row(1) + b.row(0);   // views work in any expression
+//
+// Assigning to a view writes through to the matrix; MatrixView<const T>,
+// which const matrices give out, is the read-only form.
+template <typename T>
+class MatrixView : public MatrixExpr<MatrixView<T>> {
+public:
+    using value_type = std::remove_const_t<T>;
+
+    MatrixView(T* data, size_t rows, size_t cols, size_t rowStride, size_t colStride = 1)
+    : ptr(data), rows(rows), cols(cols), rowStride(rowStride), colStride(colStride) {}
+
+    MatrixView(const MatrixView& other) = default;
+
+    // A writable view converts to a read-only one
+    template <typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    MatrixView(const MatrixView<U>& other)
+    : MatrixView(other.data(), other.getRows(), other.getCols(), other.getStride(), other.getColStride()) {}
+
+    // Copies the elements of other, or of an expression of the same shape,
+    // into the viewed elements
+    MatrixView& operator=(const MatrixView& other);
+
+    template <typename E>
+    MatrixView& operator=(const MatrixExpr<E>& expr);
+
+    // In-place updates of the viewed elements, as for Matrix<T>
+    template <typename E>
+    MatrixView& operator+=(const MatrixExpr<E>& expr);
+    template <typename E>
+    MatrixView& operator-=(const MatrixExpr<E>& expr);
+    MatrixView& operator*=(value_type scalar);
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t getStride() const { return rowStride; }
+    size_t getColStride() const { return colStride; }
+
+    T& operator()(size_t i, size_t j) const { return ptr[i * rowStride + j * colStride]; }
+    T* data() const { return ptr; }
+
+    value_type getElement(size_t i, size_t j) const;
+
+    // Views of a view, into the same matrix
+    MatrixView block(size_t i, size_t j, size_t r, size_t c) const;
+    MatrixView row(size_t i) const { return block(i, 0, 1, cols); }
+    MatrixView col(size_t j) const { return block(0, j, rows, 1); }
+    MatrixView transpose() const { return MatrixView(ptr, cols, rows, colStride, rowStride); }
+
+    // Copies the viewed elements into dst
+    void evalTo(Matrix<value_type>& dst) const;
+
+private:
+    T* ptr;
+    size_t rows, cols;
+    size_t rowStride; // elements between (i, j) and (i + 1, j)
+    size_t colStride; // elements between (i, j) and (i, j + 1)
+};
+
+// Matrices and views are the leaves of an expression that have a strided
+// layout, which the kernels can read directly
+template <typename E>
+struct IsStridedLeaf : std::false_type {};
+
+template <typename T>
+struct IsStridedLeaf<Matrix<T>> : std::true_type {};
+
+template <typename T>
+struct IsStridedLeaf<MatrixView<T>> : std::true_type {};
+
+namespace detail {
+
+template <typename T>
+MatrixView<const T> constView(const Matrix<T>& m) {
+    return MatrixView<const T>(m.data(), m.getRows(), m.getCols(), m.getStride());
+}
+
+template <typename T>
+MatrixView<const std::remove_const_t<T>> constView(const MatrixView<T>& v) {
+    return v;
+}
+
+// The destination forms: a whole matrix, or a view that isn't read-only
+template <typename T>
+MatrixView<T> writableView(Matrix<T>& m) {
+    return MatrixView<T>(m.data(), m.getRows(), m.getCols(), m.getStride());
+}
+
+template <typename T>
+MatrixView<T> writableView(const MatrixView<T>& v) {
+    static_assert(!std::is_const<T>::value, "Cannot write through a read-only view");
+    return v;
+}
+
+// Runs body(begin, end) over bands of rows, across the thread pool when
+// the work is large enough
+template <typename F>
+void forRowBands(size_t rows, size_t work, F&& body) {
+    if (parallel::worthSplitting(work, parallel::elementwiseThreshold)) {
+        size_t bandRows = std::max<size_t>(1, rows / (4 * parallel::threadCount()));
+        size_t bands = (rows + bandRows - 1) / bandRows;
+        parallel::parallelFor(bands, [&](size_t band) {
+            body(band * bandRows, std::min(rows, (band + 1) * bandRows));
+        });
+    } else {
+        body(0, rows);
+    }
+}
+
+// Whether two layouts share any memory; only addresses are compared, so a
+// view of every other column overlaps one of the columns in between
+template <typename T>
+bool overlapsView(const MatrixView<const T>& a, const MatrixView<const T>& b) {
+    if (a.getRows() == 0 || a.getCols() == 0 || b.getRows() == 0 || b.getCols() == 0) {
+        return false;
+    }
+    std::less<const T*> before;
+    const T* aLast = &a(a.getRows() - 1, a.getCols() - 1);
+    const T* bLast = &b(b.getRows() - 1, b.getCols() - 1);
+    // Either stride may be the larger one, so take the extremes of both corners
+    const T* aBegin = std::min(a.data(), aLast, before);
+    const T* aEnd = std::max(a.data(), aLast, before);
+    const T* bBegin = std::min(b.data(), bLast, before);
+    const T* bEnd = std::max(b.data(), bLast, before);
+    return !before(aEnd, bBegin) && !before(bEnd, aBegin);
+}
+
+template <typename A, typename B>
+bool overlaps(const A& a, const B& b) {
+    return overlapsView(constView(a), constView(b));
+}
+
+// Whether evaluating expr element by element straight into dst could read
+// an element that has already been written: some leaf shares dst's memory
+// through a different layout, as in m = m + m.transpose()
+template <typename E, typename T>
+bool conflicts(const E& expr, const MatrixView<const T>& dst) {
+    if constexpr (IsStridedLeaf<E>::value) {
+        MatrixView<const T> src = constView(expr);
+        bool sameLayout = src.data() == dst.data() && src.getStride() == dst.getStride() &&
+                          src.getColStride() == dst.getColStride();
+        return !sameLayout && overlapsView(src, dst);
+    } else {
+        return expr.conflicts(dst);
+    }
+}
+
+template <typename T>
+void copyElements(const MatrixView<const T>& src, const MatrixView<T>& dst) {
+    // One side transposed against the other (m = a.transpose(), or
+    // m.transpose() = a) goes through the cache-oblivious kernels
+    if (src.getRows() > 1 && src.getCols() > 1) {
+        if (src.getStride() == 1 && dst.getColStride() == 1) {
+            layout::transpose(src.getCols(), src.getRows(), src.data(), src.getColStride(),
+                              dst.data(), dst.getStride());
+            return;
+        }
+        if (src.getColStride() == 1 && dst.getStride() == 1) {
+            layout::transpose(src.getRows(), src.getCols(), src.data(), src.getStride(),
+                              dst.data(), dst.getColStride());
+            return;
+        }
+    }
+    for (size_t i = 0; i < src.getRows(); i++) {
+        if (src.getColStride() == 1 && dst.getColStride() == 1) {
+            std::copy_n(&src(i, 0), src.getCols(), &dst(i, 0));
+        } else {
+            for (size_t j = 0; j < src.getCols(); j++) {
+                dst(i, j) = src(i, j);
+            }
+        }
+    }
+}
+
+// dst += alpha * src, element by element; the two must not conflict
+template <typename T>
+void axpyElements(T alpha, const MatrixView<const T>& src, const MatrixView<T>& dst) {
+    forRowBands(src.getRows(), src.getRows() * src.getCols(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (src.getColStride() == 1 && dst.getColStride() == 1) {
+                simd::axpy(alpha, &src(i, 0), &dst(i, 0), src.getCols());
+            } else {
+                for (size_t j = 0; j < src.getCols(); j++) {
+                    dst(i, j) += alpha * src(i, j);
+                }
+            }
+        }
+    });
+}
+
+// c = alpha * a * b + beta * c for two strided leaves; c has row stride
+// ldc and overlaps neither
+template <typename A, typename B, typename T>
+void multiplyInto(const A& a, const B& b, T* c, size_t ldc, T alpha = T(1), T beta = T(0)) {
+    auto x = constView(a);
+    auto y = constView(b);
+    // Plain row-major products large enough for Strassen-Winograd
+    if (alpha == T(1) && beta == T(0) && x.getColStride() == 1 && y.getColStride() == 1) {
+        strassen::multiply(x.getRows(), y.getCols(), x.getCols(), x.data(), x.getStride(), y.data(),
+                           y.getStride(), c, ldc);
+        return;
+    }
+    gemm::multiplyAdd(x.getRows(), y.getCols(), x.getCols(), alpha, x.data(), x.getStride(), x.getColStride(),
+                      y.data(), y.getStride(), y.getColStride(), beta, c, ldc);
+}
+
+} // namespace detail
+
+
+// ------------------ EXPRESSION TEMPLATES ------------------
+
+// Matrices (and the transform classes, through their Matrix<T> base) are
+// held by reference; views and intermediate nodes are small and held by
+// value, so an expression stays valid for as long as its matrices do.
+template <typename E>
+struct ExprNested { using type = const E; };
+
+template <typename T>
+struct ExprNested<Matrix<T>> { using type = const Matrix<T>&; };
+
+template <typename E>
+struct IsMatrixLeaf : std::false_type {};
+
+template <typename T>
+struct IsMatrixLeaf<Matrix<T>> : std::true_type {};
+
+// Leaves are used in place, anything else is evaluated into a temporary
+template <typename T>
+const Matrix<T>& evaluated(const MatrixExpr<Matrix<T>>& expr) {
+    return expr.self();
+}
+
+template <typename E>
+Matrix<typename E::value_type> evaluated(const MatrixExpr<E>& expr) {
+    return Matrix<typename E::value_type>(expr);
+}
+
+struct AddOp {
+    static constexpr const char* name = "addition";
+    template <typename T> static constexpr T apply(T a, T b) { return a + b; }
+    template <typename T> static void applyRow(const T* a, const T* b, T* out, size_t n) { simd::add(a, b, out, n); }
+};
+
+struct SubOp {
+    static constexpr const char* name = "subtraction";
+    template <typename T> static constexpr T apply(T a, T b) { return a - b; }
+    template <typename T> static void applyRow(const T* a, const T* b, T* out, size_t n) { simd::sub(a, b, out, n); }
+};
+
+// Lazy element-wise combination of two expressions of equal shape
+template <typename L, typename R, typename Op>
+class MatrixElementwise : public MatrixExpr<MatrixElementwise<L, R, Op>> {
+    typename ExprNested<L>::type lhs;
+    typename ExprNested<R>::type rhs;
+
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same<value_type, typename R::value_type>::value,
+                  "Matrix expressions must share an element type");
+
+    MatrixElementwise(const L& l, const R& r) : lhs(l), rhs(r) {
+        if (lhs.getRows() != rhs.getRows() || lhs.getCols() != rhs.getCols()) {
+            throw runtime_error(string("Error: Matrix sizes do not match for ") + Op::name + "!");
+        }
+    }
+
+    size_t getRows() const { return lhs.getRows(); }
+    size_t getCols() const { return lhs.getCols(); }
+
+    value_type operator()(size_t i, size_t j) const {
+        return Op::apply(lhs(i, j), rhs(i, j));
+    }
+
+    // Element-wise results never read another element, so writing straight
+    // into an operand is safe as long as it doesn't have to be reallocated
+    // and no view reads it in a different order (m = m + m.transpose())
+    void evalTo(Matrix<value_type>& dst) const {
+        if (dst.getRows() != getRows() || dst.getCols() != getCols() || conflicts(detail::constView(dst))) {
+            Matrix<value_type> result(getRows(), getCols(), dst.resultResource(getRows(), getCols()));
+            evalTo(result);
+            dst = std::move(result);
+            return;
+        }
+        evalInto(dst);
+    }
+
+    // dst already has our shape and doesn't conflict (see MatrixView::operator=)
+    void evalTo(const MatrixView<value_type>& dst) const {
+        evalInto(dst);
+    }
+
+    bool conflicts(const MatrixView<const value_type>& dst) const {
+        return detail::conflicts(lhs, dst) || detail::conflicts(rhs, dst);
+    }
+
+    // Evaluates nested products up front, so that threads only ever read them
+    void prime() const {
+        if constexpr (!IsStridedLeaf<L>::value) {
+            lhs.prime();
+        }
+        if constexpr (!IsStridedLeaf<R>::value) {
+            rhs.prime();
+        }
+    }
+
+private:
+    template <typename Dst>
+    void evalInto(Dst& dst) const {
+        // Large results are split into bands of rows across the thread pool
+        size_t rows = getRows();
+        if (parallel::worthSplitting(rows * getCols(), parallel::elementwiseThreshold)) {
+            prime();
+            size_t bandRows = std::max<size_t>(1, rows / (4 * parallel::threadCount()));
+            size_t bands = (rows + bandRows - 1) / bandRows;
+            parallel::parallelFor(bands, [&](size_t band) {
+                evalRows(dst, band * bandRows, std::min(rows, (band + 1) * bandRows));
+            });
+            return;
+        }
+        evalRows(dst, 0, rows);
+    }
+
+    template <typename Dst>
+    void evalRows(Dst& dst, size_t begin, size_t end) const {
+        if constexpr (IsStridedLeaf<L>::value && IsStridedLeaf<R>::value) {
+            // Two matrices or views with contiguous rows go through the
+            // vector kernels a row at a time
+            if (detail::constView(lhs).getColStride() == 1 && detail::constView(rhs).getColStride() == 1 &&
+                detail::constView(dst).getColStride() == 1) {
+                for (size_t i = begin; i < end; i++) {
+                    Op::applyRow(&lhs(i, 0), &rhs(i, 0), &dst(i, 0), getCols());
+                }
+                return;
+            }
+        }
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < getCols(); j++) {
+                dst(i, j) = (*this)(i, j);
+            }
+        }
+    }
+};
+
+// Lazy matrix product. It is only computed on assignment, or once into a
+// cache when it is nested inside an element-wise expression.
+template <typename L, typename R>
+class MatrixProduct : public MatrixExpr<MatrixProduct<L, R>> {
+public:
+    using value_type = typename L::value_type;
+    static_assert(std::is_same<value_type, typename R::value_type>::value,
+                  "Matrix expressions must share an element type");
+
+private:
+    typename ExprNested<L>::type lhs;
+    typename ExprNested<R>::type rhs;
+    mutable Matrix<value_type> cache;
+    mutable bool cached = false;
+
+public:
+    MatrixProduct(const L& l, const R& r) : lhs(l), rhs(r) {
+        if (lhs.getCols() != rhs.getRows()) {
+            throw runtime_error("Error: Matrix sizes do not match for multiplication!");
+        }
+    }
+
+    size_t getRows() const { return lhs.getRows(); }
+    size_t getCols() const { return rhs.getCols(); }
+
+    value_type operator()(size_t i, size_t j) const {
+        prime();
+        return cache(i, j);
+    }
+
+    void prime() const {
+        if (!cached) {
+            evalTo(cache);
+            cached = true;
+        }
+    }
+
+    void evalTo(Matrix<value_type>& dst) const {
+        if constexpr (IsStridedLeaf<L>::value && IsStridedLeaf<R>::value) {
+            // The kernel reads operands while writing dst, so A = A * B, or
+            // a product of views into dst, has to go through a temporary
+            if (detail::overlaps(lhs, dst) || detail::overlaps(rhs, dst)) {
+                Matrix<value_type> result(getRows(), getCols(), dst.resultResource(getRows(), getCols()));
+                detail::multiplyInto(lhs, rhs, result.data(), result.getStride());
+                dst = std::move(result);
+            } else {
+                dst.reshape(getRows(), getCols());
+                detail::multiplyInto(lhs, rhs, dst.data(), dst.getStride());
+            }
+        } else if constexpr (!IsMatrixLeaf<L>::value) {
+            // The evaluated left operand is ours, so its buffer can take the
+            // result, which the resource it comes from is chosen for
+            const auto& right = evaluated(rhs);
+            Matrix<value_type> left(dst.resultResource(getRows(), getCols()));
+            lhs.evalTo(left);
+            dst = Matrix<value_type>::multiply(std::move(left), right);
+        } else {
+            Matrix<value_type> right(dst.resultResource(getRows(), getCols()));
+            rhs.evalTo(right);
+            dst = Matrix<value_type>::multiply(lhs, std::move(right));
+        }
+    }
+
+    // dst already has our shape. Rows of the product go straight into a
+    // block of another matrix when the operands can be read in place.
+    void evalTo(const MatrixView<value_type>& dst) const {
+        if constexpr (IsStridedLeaf<L>::value && IsStridedLeaf<R>::value) {
+            if (dst.getColStride() == 1 && !detail::overlaps(lhs, dst) && !detail::overlaps(rhs, dst)) {
+                detail::multiplyInto(lhs, rhs, dst.data(), dst.getStride());
+                return;
+            }
+        }
+        prime();
+        detail::copyElements(detail::constView(cache), dst);
+    }
+
+    // dst += alpha * product. Operands that can be read in place go
+    // through the kernels, which add into dst as they store, so m += a * b
+    // needs no temporary.
+    void addTo(const MatrixView<value_type>& dst, value_type alpha) const {
+        if (dst.getRows() != getRows() || dst.getCols() != getCols()) {
+            throw runtime_error("Error: Matrix sizes do not match for addition!");
+        }
+        if constexpr (IsStridedLeaf<L>::value && IsStridedLeaf<R>::value) {
+            if (dst.getColStride() == 1 && !detail::overlaps(lhs, dst) && !detail::overlaps(rhs, dst)) {
+                detail::multiplyInto(lhs, rhs, dst.data(), dst.getStride(), alpha, value_type(1));
+                return;
+            }
+        }
+        prime();
+        detail::axpyElements(alpha, detail::constView(cache), dst);
+    }
+
+    // The product is computed in full before anything is written
+    bool conflicts(const MatrixView<const value_type>&) const {
+        return false;
+    }
+};
+
+template <typename E>
+struct IsProduct : std::false_type {};
+
+template <typename L, typename R>
+struct IsProduct<MatrixProduct<L, R>> : std::true_type {};
+
+template <typename L, typename R>
+MatrixElementwise<L, R, AddOp> operator+(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+    return MatrixElementwise<L, R, AddOp>(lhs.self(), rhs.self());
+}
+
+template <typename L, typename R>
+MatrixElementwise<L, R, SubOp> operator-(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+    return MatrixElementwise<L, R, SubOp>(lhs.self(), rhs.self());
+}
+
+template <typename L, typename R>
+MatrixProduct<L, R> operator*(const MatrixExpr<L>& lhs, const MatrixExpr<R>& rhs) {
+    return MatrixProduct<L, R>(lhs.self(), rhs.self());
+}
+
+// A temporary Matrix operand is consumed instead: the result is computed
+// eagerly into its buffer, so it neither dangles nor allocates
+template <typename T, typename R>
+Matrix<T> operator+(Matrix<T>&& lhs, const MatrixExpr<R>& rhs) {
+    MatrixElementwise<Matrix<T>, R, AddOp>(lhs, rhs.self()).evalTo(lhs);
+    return std::move(lhs);
+}
+
+template <typename L, typename T>
+Matrix<T> operator+(const MatrixExpr<L>& lhs, Matrix<T>&& rhs) {
+    MatrixElementwise<L, Matrix<T>, AddOp>(lhs.self(), rhs).evalTo(rhs);
+    return std::move(rhs);
+}
+
+template <typename T>
+Matrix<T> operator+(Matrix<T>&& lhs, Matrix<T>&& rhs) {
+    return std::move(lhs) + static_cast<const Matrix<T>&>(rhs);
+}
+
+template <typename T, typename R>
+Matrix<T> operator-(Matrix<T>&& lhs, const MatrixExpr<R>& rhs) {
+    MatrixElementwise<Matrix<T>, R, SubOp>(lhs, rhs.self()).evalTo(lhs);
+    return std::move(lhs);
+}
+
+template <typename L, typename T>
+Matrix<T> operator-(const MatrixExpr<L>& lhs, Matrix<T>&& rhs) {
+    MatrixElementwise<L, Matrix<T>, SubOp>(lhs.self(), rhs).evalTo(rhs);
+    return std::move(rhs);
+}
+
+template <typename T>
+Matrix<T> operator-(Matrix<T>&& lhs, Matrix<T>&& rhs) {
+    return std::move(lhs) - static_cast<const Matrix<T>&>(rhs);
+}
+
+template <typename T, typename R>
+Matrix<T> operator*(Matrix<T>&& lhs, const MatrixExpr<R>& rhs) {
+    const auto& right = evaluated(rhs);
+    return Matrix<T>::multiply(std::move(lhs), right);
+}
+
+template <typename L, typename T>
+Matrix<T> operator*(const MatrixExpr<L>& lhs, Matrix<T>&& rhs) {
+    const auto& left = evaluated(lhs);
+    return Matrix<T>::multiply(left, std::move(rhs));
+}
+
+template <typename T>
+Matrix<T> operator*(Matrix<T>&& lhs, Matrix<T>&& rhs) {
+    return Matrix<T>::multiply(std::move(lhs), rhs);
+}
+
+// ------------------ LU DECOMPOSITION ------------------
+
+// P A = L U for a square A, with partial pivoting. The factors are kept
+// in one matrix, L (unit diagonal, not stored) below the diagonal and U
+// on and above it; moving A in factors it in its own buffer.
+//
+//     LUDecomposition<double> lu(a);
+//     Matrix<double> x = lu.solve(b); // A x = b, for any number of columns
+//     double det = lu.determinant();
+template <typename T>
+class LUDecomposition {
+public:
+    explicit LUDecomposition(const Matrix<T>& a) : packed(a) { factorize(); }
+    explicit LUDecomposition(Matrix<T>&& a) : packed(std::move(a)) { factorize(); }
+
+    const Matrix<T>& factors() const { return packed; }
+
+    // Row i was swapped with row pivots()[i], for i in increasing order
+    const std::vector<size_t>& pivots() const { return rowSwaps; }
+
+    // Whether U has a zero on its diagonal
+    bool isSingular() const;
+
+    T determinant() const;
+
+    // These throw for a singular matrix
+    Matrix<T> solve(const Matrix<T>& b) const;
+    Matrix<T> inverse() const;
+
+private:
+    Matrix<T> packed;
+    std::vector<size_t> rowSwaps;
+
+    void factorize();
+};
+
+
+// ------------------ FIXED-SIZE MATRICES ------------------
+
+// Matrix<T, R, C> keeps its elements inline, so it never touches the heap.
+// Everything is constexpr and the arithmetic is fully unrolled, which lets
+// matrices built from constants fold away at compile time.
+template <typename T, size_t R, size_t C>
+class Matrix {
+    static_assert(R != Dynamic && C != Dynamic, "Use Matrix<T> for runtime-sized matrices");
+    static_assert(R > 0 && C > 0, "Fixed-size matrices cannot be empty");
+
+protected:
+    T mat[R * C];
+
+public:
+    // Zero-initialized, like Matrix<T>(m, n)
+    constexpr Matrix() : mat{} {}
+
+    using value_type = T;
+
+    void inputMatrix();
+    void display() const;
+
+    constexpr T getElement(size_t i, size_t j) const;
+    constexpr void setElement(size_t i, size_t j, T value);
+
+    static constexpr size_t getRows() { return R; }
+    static constexpr size_t getCols() { return C; }
+    static constexpr size_t getStride() { return C; }
+
+    constexpr T& operator()(size_t i, size_t j) { return mat[i * C + j]; }
+    constexpr const T& operator()(size_t i, size_t j) const { return mat[i * C + j]; }
+
+    constexpr T* data() { return mat; }
+    constexpr const T* data() const { return mat; }
+
+    // Vector projection implementation
+    static constexpr Matrix<T, R, C> projection(const Matrix<T, R, C>& vec1, const Matrix<T, R, C>& vec2);
+};
+
+// Shearing
+template <typename T, size_t N>
+class ShearMatrix : public Matrix<T, N, N> {
+    static_assert(N >= 2, "Shearing needs at least two dimensions");
+
+public:
+    // Default constructor
+    constexpr ShearMatrix() : Matrix<T, N, N>() {}
+
+    constexpr ShearMatrix(T shearX, T shearY);
+    void transform();
+};
+
+// Rotation
+template <typename T, size_t N>
+class RotateMatrix : public Matrix<T, N, N> {
+    static_assert(N == 2, "Rotation is only defined for 2x2 matrices");
+
+public:
+    // Default constructor
+    constexpr RotateMatrix() : Matrix<T, N, N>() {}
+
+    RotateMatrix(T angle);
+    void transform();
+};
+
+// Scaling
+template <typename T, size_t N>
+class ScaleMatrix : public Matrix<T, N, N> {
+    static_assert(N >= 2, "Scaling needs at least two dimensions");
+
+public:
+    // Default constructor
+    constexpr ScaleMatrix() : Matrix<T, N, N>() {}
+
+    constexpr ScaleMatrix(T scaleX, T scaleY);
+    void transform();
+};
+
+// Reflection
+template <typename T, size_t N>
+class ReflectMatrix : public Matrix<T, N, N> {
+    static_assert(N >= 2, "Reflection needs at least two dimensions");
+
+public:
+    // Default constructor
+    constexpr ReflectMatrix() : Matrix<T, N, N>() {}
+
+    constexpr ReflectMatrix(bool reflectX, bool reflectY);
+    void transform();
+};
+
+namespace detail {
+
+// Keeps the fixed-size operators away from Matrix<T>, whose dimensions
+// would otherwise deduce as Dynamic
+template <size_t... Dims>
+using EnableIfFixed = std::enable_if_t<((Dims != Dynamic) && ...), int>;
+
+template <typename T, size_t R, size_t C, typename Op, size_t... e>
+constexpr Matrix<T, R, C> fixedElementwise(const Matrix<T, R, C>& a, const Matrix<T, R, C>& b,
+                                           std::index_sequence<e...>) {
+    Matrix<T, R, C> result;
+    ((result.data()[e] = Op::apply(a.data()[e], b.data()[e])), ...);
+    return result;
+}
+
+template <typename T, size_t R, size_t K, size_t C, size_t... k>
+constexpr T fixedDot(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b, size_t i, size_t j,
+                     std::index_sequence<k...>) {
+    return (T(0) + ... + (a(i, k) * b(k, j)));
+}
+
+template <typename T, size_t R, size_t K, size_t C, size_t... e>
+constexpr Matrix<T, R, C> fixedMultiply(const Matrix<T, R, K>& a, const Matrix<T, K, C>& b,
+                                        std::index_sequence<e...>) {
+    Matrix<T, R, C> result;
+    ((result(e / C, e % C) = fixedDot(a, b, e / C, e % C, std::make_index_sequence<K>{})), ...);
+    return result;
+}
+
+} // namespace detail
+
+template <typename T, size_t R, size_t C, detail::EnableIfFixed<R, C> = 0>
+constexpr Matrix<T, R, C> operator+(const Matrix<T, R, C>& lhs, const Matrix<T, R, C>& rhs) {
+    return detail::fixedElementwise<T, R, C, AddOp>(lhs, rhs, std::make_index_sequence<R * C>{});
+}
+
+template <typename T, size_t R, size_t C, detail::EnableIfFixed<R, C> = 0>
+constexpr Matrix<T, R, C> operator-(const Matrix<T, R, C>& lhs, const Matrix<T, R, C>& rhs) {
+    return detail::fixedElementwise<T, R, C, SubOp>(lhs, rhs, std::make_index_sequence<R * C>{});
+}
+
+// Sizes are checked by the type system, so a mismatched product doesn't compile
+template <typename T, size_t R, size_t K, size_t C, detail::EnableIfFixed<R, K, C> = 0>
+constexpr Matrix<T, R, C> operator*(const Matrix<T, R, K>& lhs, const Matrix<T, K, C>& rhs) {
+    return detail::fixedMultiply(lhs, rhs, std::make_index_sequence<R * C>{});
+}
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T>
+Matrix<T>::Matrix(size_t m, size_t n, std::pmr::memory_resource* resource)
+: rows(m), cols(n), stride(n), capacity(0), mat(nullptr), adopted(false), resource(resource) {
+    instrument::constructed<T>();
+    if (rows > 0 && cols > 0) {
+        mat = allocate(rows * stride, true);
+        capacity = rows * stride;
+    }
+}
+
+template <typename T>
+Matrix<T>::Matrix(size_t m, size_t n, size_t stride, T* data, std::pmr::memory_resource* resource)
+: rows(m), cols(n), stride(stride), capacity(m * stride), mat(data), adopted(true), resource(resource) {
+    instrument::constructed<T>();
+    instrument::allocated<T>(capacity * sizeof(T), true);
+}
+
+// Copy constructor implementation
+template <typename T>
+Matrix<T>::Matrix(const Matrix<T>& other)
+: rows(other.rows), cols(other.cols), stride(other.cols), capacity(0), mat(nullptr), adopted(false),
+  resource(std::pmr::get_default_resource()) {
+    instrument::copyConstructed<T>();
+    if (rows > 0 && cols > 0) {
+        mat = allocate(rows * stride, false);
+        capacity = rows * stride;
+        for (size_t i = 0; i < rows; i++) {
+            std::copy_n(other.mat + i * other.stride, cols, mat + i * stride);
+        }
+    }
+}
+
+// Move constructor implementation
+template <typename T>
+Matrix<T>::Matrix(Matrix<T>&& other) noexcept
+: rows(0), cols(0), stride(0), capacity(0), mat(nullptr), adopted(false), resource(other.resource) {
+    instrument::moveConstructed<T>();
+    steal(other);
+}
+
+// Expression constructor implementation
+template <typename T>
+template <typename E>
+Matrix<T>::Matrix(const MatrixExpr<E>& expr) : Matrix() {
+    expr.self().evalTo(*this);
+}
+
+// Assignment operator implementation
+template <typename T>
+Matrix<T>& Matrix<T>::operator=(const Matrix<T>& other) {
+    if (this != &other) {
+        instrument::copyAssigned<T>();
+        // Reuse the buffer when it is already the right size
+        reshape(other.rows, other.cols);
+        for (size_t i = 0; i < rows; i++) {
+            std::copy_n(other.mat + i * other.stride, cols, mat + i * stride);
+        }
+    }
+    return *this;
+}
+
+// Move assignment operator implementation
+template <typename T>
+Matrix<T>& Matrix<T>::operator=(Matrix<T>&& other) noexcept {
+    if (adopted && other.rows == rows && other.cols == cols) {
+        instrument::moveAssigned<T>();
+        if (other.mat != mat) {
+            for (size_t i = 0; i < rows; i++) {
+                std::copy_n(other.mat + i * other.stride, cols, mat + i * stride);
+            }
+        }
+        return *this;
+    }
+    if (this != &other) {
+        instrument::moveAssigned<T>();
+        release();
+        resource = other.resource;
+        steal(other);
+    }
+    return *this;
+}
+
 template <typename T>
-class ReflectMatrix : public Matrix<T> {
-public:
-    // Default constructor
-    ReflectMatrix() : Matrix<T>() {}
-   
-    ReflectMatrix(size_t m, size_t n, bool reflectX, bool reflectY);
-    void transform();
-};
+void Matrix<T>::steal(Matrix<T>& other) noexcept {
+    rows = other.rows;
+    cols = other.cols;
+    stride = other.stride;
+    capacity = other.capacity;
+    adopted = other.adopted;
+    if (other.isInline()) {
+        std::move(other.local, other.local + capacity, local);
+        mat = local;
+    } else {
+        mat = other.mat;
+    }
+    other.rows = other.cols = other.stride = other.capacity = 0;
+    other.mat = nullptr;
+    other.adopted = false;
+}
 
+// Expression assignment implementation
+template <typename T>
+template <typename E>
+Matrix<T>& Matrix<T>::operator=(const MatrixExpr<E>& expr) {
+    expr.self().evalTo(*this);
+    return *this;
+}
 
+template <typename T>
+template <typename E>
+Matrix<T>& Matrix<T>::operator+=(const MatrixExpr<E>& expr) {
+    if constexpr (IsProduct<E>::value) {
+        expr.self().addTo(detail::writableView(*this), T(1));
+    } else {
+        *this = *this + expr;
+    }
+    return *this;
+}
 
-// ------------------ DEFINITIONS ------------------
+template <typename T>
+template <typename E>
+Matrix<T>& Matrix<T>::operator-=(const MatrixExpr<E>& expr) {
+    if constexpr (IsProduct<E>::value) {
+        expr.self().addTo(detail::writableView(*this), T(-1));
+    } else {
+        *this = *this - expr;
+    }
+    return *this;
+}
 
 template <typename T>
-Matrix<T>::Matrix(size_t m, size_t n) : rows(m), cols(n) {
-    mat = new T*[rows];
+Matrix<T>& Matrix<T>::operator*=(T scalar) {
     for (size_t i = 0; i < rows; i++) {
-        mat[i] = new T[cols]{0};
+        simd::scale(scalar, mat + i * stride, cols);
     }
+    return *this;
 }
 
-// Copy constructor implementation
 template <typename T>
-Matrix<T>::Matrix(const Matrix<T>& other) : rows(other.rows), cols(other.cols) {
-    // Allocate memory
-    mat = nullptr;
-    if (rows > 0 && cols > 0) {
-        mat = new T*[rows];
-        for (size_t i = 0; i < rows; i++) {
-            mat[i] = new T[cols];
-            // Copy values
-            for (size_t j = 0; j < cols; j++) {
-                mat[i][j] = other.mat[i][j];
-            }
-        }
+template <typename E>
+Matrix<T>& Matrix<T>::operator*=(const MatrixExpr<E>& expr) {
+    const auto& right = evaluated(expr);
+    if (multipliesInPlace(*this, right)) {
+        *this = multiply(std::move(*this), right);
+    } else {
+        *this = *this * right;
     }
+    return *this;
 }
 
-// Assignment operator implementation
 template <typename T>
-Matrix<T>& Matrix<T>::operator=(const Matrix<T>& other) {
-    if (this != &other) {
-        // Clean up existing resources
-        if (mat != nullptr) {
-            for (size_t i = 0; i < rows; i++) {
-                delete[] mat[i];
-            }
-            delete[] mat;
-        }
-       
-        // Copy from other
-        rows = other.rows;
-        cols = other.cols;
-       
-        mat = nullptr;
-        if (rows > 0 && cols > 0) {
-            mat = new T*[rows];
-            for (size_t i = 0; i < rows; i++) {
-                mat[i] = new T[cols];
-                for (size_t j = 0; j < cols; j++) {
-                    mat[i][j] = other.mat[i][j];
-                }
-            }
+T* Matrix<T>::allocate(size_t count, bool zeroed) {
+    if (count <= inlineCapacity) {
+        if (zeroed) {
+            std::fill_n(local, count, T());
         }
+        return local;
     }
-    return *this;
+    T* buffer = static_cast<T*>(resource->allocate(count * sizeof(T), alignment));
+    if (zeroed || !std::is_trivially_default_constructible<T>::value) {
+        try {
+            std::uninitialized_value_construct_n(buffer, count);
+        } catch (...) {
+            resource->deallocate(buffer, count * sizeof(T), alignment);
+            throw;
+        }
+    }
+    instrument::allocated<T>(count * sizeof(T));
+    return buffer;
 }
 
 template <typename T>
-Matrix<T>::~Matrix() {
-    if (mat != nullptr) {
-        for (size_t i = 0; i < rows; i++) {
-            delete[] mat[i];
+void Matrix<T>::release() noexcept {
+    if (mat != nullptr && !isInline()) {
+        std::destroy_n(mat, capacity);
+        resource->deallocate(mat, capacity * sizeof(T), alignment);
+        instrument::released<T>(capacity * sizeof(T), adopted);
+    }
+    mat = nullptr;
+    capacity = 0;
+    adopted = false;
+}
+
+// A matrix that already has the shape keeps its buffer and stride
+template <typename T>
+void Matrix<T>::reshape(size_t m, size_t n) {
+    if (m == rows && n == cols) {
+        return;
+    }
+    if (capacity != m * n) {
+        release();
+        if (m > 0 && n > 0) {
+            mat = allocate(m * n, false);
+            capacity = m * n;
         }
-        delete[] mat;
     }
+    rows = m;
+    cols = stride = n;
+}
+
+template <typename T>
+std::pmr::memory_resource* Matrix<T>::resultResource(size_t m, size_t n) const {
+    return adopted && m == rows && n == cols ? std::pmr::get_default_resource() : resource;
+}
+
+template <typename T>
+Matrix<T>::~Matrix() {
+    release();
 }
 
 template <typename T>
@@ -170,7 +1188,7 @@ void Matrix<T>::inputMatrix() {
     cout << "Enter elements of " << rows << "x" << cols << " matrix (row-wise):\n";
     for (size_t i = 0; i < rows; i++) {
         for (size_t j = 0; j < cols; j++) {
-            cin >> mat[i][j];
+            cin >> (*this)(i, j);
         }
     }
 }
@@ -184,7 +1202,7 @@ void Matrix<T>::display() const {
    
     for (size_t i = 0; i < rows; i++) {
         for (size_t j = 0; j < cols; j++) {
-            cout << mat[i][j] << " ";
+            cout << (*this)(i, j) << " ";
         }
         cout << endl;
     }
@@ -195,7 +1213,7 @@ T Matrix<T>::getElement(size_t i, size_t j) const {
     if (i >= rows || j >= cols || mat == nullptr) {
         throw std::out_of_range("Matrix index out of range");
     }
-    return mat[i][j];
+    return (*this)(i, j);
 }
 
 template <typename T>
@@ -203,7 +1221,7 @@ void Matrix<T>::setElement(size_t i, size_t j, T value) {
     if (i >= rows || j >= cols || mat == nullptr) {
         throw std::out_of_range("Matrix index out of range");
     }
-    mat[i][j] = value;
+    (*this)(i, j) = value;
 }
 
 template <typename T>
@@ -217,68 +1235,117 @@ size_t Matrix<T>::getCols() const {
 }
 
 template <typename T>
-Matrix<T> Matrix<T>::operator+(const Matrix<T>& other) const {
-    if (rows != other.rows || cols != other.cols) {
-        throw runtime_error("Error: Matrix sizes do not match for addition!");
-    }
-    Matrix<T> result(rows, cols);
-    for (size_t i = 0; i < rows; i++) {
-        for (size_t j = 0; j < cols; j++) {
-            result.mat[i][j] = mat[i][j] + other.mat[i][j];
-        }
-    }
-    return result;
+size_t Matrix<T>::getStride() const {
+    return stride;
+}
+
+template <typename T>
+void Matrix<T>::multiply(const Matrix<T>& a, const Matrix<T>& b, Matrix<T>& dst) {
+    strassen::multiply(a.rows, b.cols, a.cols, a.mat, a.stride, b.mat, b.stride, dst.mat, dst.stride);
 }
 
 template <typename T>
-Matrix<T> Matrix<T>::operator-(const Matrix<T>& other) const {
-    if (rows != other.rows || cols != other.cols) {
-        throw runtime_error("Error: Matrix sizes do not match for subtraction!");
+Matrix<T> Matrix<T>::multiply(Matrix<T>&& a, const Matrix<T>& b) {
+    if (a.cols != b.rows) {
+        throw runtime_error("Error: Matrix sizes do not match for multiplication!");
     }
-    Matrix<T> result(rows, cols);
-    for (size_t i = 0; i < rows; i++) {
-        for (size_t j = 0; j < cols; j++) {
-            result.mat[i][j] = mat[i][j] - other.mat[i][j];
+    // Row i of the product only reads row i of a, so each finished row
+    // can be packed into the front of a's buffer as long as it is no wider.
+    // That loop is naive, so it only takes products with a tiny inner
+    // dimension; anything more goes to the packed kernel, as does every
+    // product under a wider accumulation mode (see simd::Accumulation).
+    if (!multipliesInPlace(a, b)) {
+        // An adopted buffer isn't ours to hand on: the product is built
+        // elsewhere and copied back into it when it fits
+        Matrix<T> result(a.rows, b.cols, a.adopted ? std::pmr::get_default_resource() : a.resource);
+        multiply(a, b, result);
+        if (a.adopted && b.cols == a.cols) {
+            a = std::move(result);
+            return std::move(a);
         }
+        return result;
     }
-    return result;
+    // Rows that keep their width stay where they are, so a borrowed
+    // buffer keeps its layout
+    size_t width = b.cols == a.cols ? a.stride : b.cols;
+    T row[inPlaceProductLimit];
+    for (size_t i = 0; i < a.rows; i++) {
+        for (size_t j = 0; j < b.cols; j++) {
+            row[j] = 0;
+            for (size_t k = 0; k < a.cols; k++) {
+                row[j] += a(i, k) * b(k, j);
+            }
+        }
+        std::copy_n(row, b.cols, a.mat + i * width);
+    }
+    a.cols = b.cols;
+    a.stride = width;
+    return std::move(a);
+}
+
+template <typename T>
+bool Matrix<T>::multipliesInPlace(const Matrix<T>& a, const Matrix<T>& b) {
+    return b.cols <= a.cols && a.cols <= inPlaceProductLimit && &a != &b && simd::nativeAccumulation<T>();
 }
 
 template <typename T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T>& other) const {
-    if (cols != other.rows) {
+Matrix<T> Matrix<T>::multiply(const Matrix<T>& a, Matrix<T>&& b) {
+    if (a.cols != b.rows) {
         throw runtime_error("Error: Matrix sizes do not match for multiplication!");
     }
-    Matrix<T> result(rows, other.cols);
-    for (size_t i = 0; i < rows; i++) {
-        for (size_t j = 0; j < other.cols; j++) {
-            for (size_t k = 0; k < cols; k++) {
-                result.mat[i][j] += mat[i][k] * other.mat[k][j];
+    // Column j of the product only reads column j of b, so it can be
+    // written back over that column as long as the result is no taller
+    // and, as above, the inner dimension is tiny and accumulation native
+    if (a.rows > b.rows || b.rows > inPlaceProductLimit || &a == &b || !simd::nativeAccumulation<T>()) {
+        Matrix<T> result(a.rows, b.cols, b.adopted ? std::pmr::get_default_resource() : b.resource);
+        multiply(a, b, result);
+        if (b.adopted && a.rows == b.rows) {
+            b = std::move(result);
+            return std::move(b);
+        }
+        return result;
+    }
+    T column[inPlaceProductLimit];
+    for (size_t j = 0; j < b.cols; j++) {
+        for (size_t i = 0; i < a.rows; i++) {
+            column[i] = 0;
+            for (size_t k = 0; k < a.cols; k++) {
+                column[i] += a(i, k) * b(k, j);
             }
         }
+        for (size_t i = 0; i < a.rows; i++) {
+            b(i, j) = column[i];
+        }
     }
-    return result;
+    b.rows = a.rows;
+    return std::move(b);
 }
 
 // Vector projection implementation
 template <typename T>
 Matrix<T> Matrix<T>::projection(const Matrix<T>& vec1, const Matrix<T>& vec2) {
     // Check if both are column vectors
-    if (vec1.cols != 1 || vec2.cols != 1 || vec1.rows < 2 || vec2.rows < 2) {
+    if (vec1.cols != 1 || vec2.cols != 1 || vec1.rows < 2 || vec1.rows != vec2.rows) {
         throw runtime_error("Error: Both matrices must be column vectors for projection!");
     }
    
+    // Column vectors are contiguous whenever their stride is 1
+    auto dot = [](const Matrix<T>& a, const Matrix<T>& b) {
+        if (a.stride == 1 && b.stride == 1) {
+            return simd::dotAccumulated(a.mat, b.mat, a.rows);
+        }
+        T sum = 0;
+        for (size_t i = 0; i < a.rows; i++) {
+            sum += a(i, 0) * b(i, 0);
+        }
+        return sum;
+    };
+
     // Calculate dot product of vec2 and vec1
-    T dotProduct = 0;
-    for (size_t i = 0; i < vec1.rows; i++) {
-        dotProduct += vec1.mat[i][0] * vec2.mat[i][0];
-    }
+    T dotProduct = dot(vec1, vec2);
    
     // Calculate magnitude squared of vec1
-    T magnitudeSquared = 0;
-    for (size_t i = 0; i < vec1.rows; i++) {
-        magnitudeSquared += vec1.mat[i][0] * vec1.mat[i][0];
-    }
+    T magnitudeSquared = dot(vec1, vec1);
    
     if (magnitudeSquared == 0) {
         throw runtime_error("Error: Cannot project onto a zero vector!");
@@ -290,24 +1357,236 @@ Matrix<T> Matrix<T>::projection(const Matrix<T>& vec1, const Matrix<T>& vec2) {
     // Create the projection vector (in the direction of vec1)
     Matrix<T> result(vec1.rows, 1);
     for (size_t i = 0; i < vec1.rows; i++) {
-        result.mat[i][0] = vec1.mat[i][0] * scalarProj;
+        result(i, 0) = vec1(i, 0) * scalarProj;
     }
    
     return result;
 }
 
+template <typename T>
+MatrixView<T> Matrix<T>::block(size_t i, size_t j, size_t r, size_t c) {
+    return MatrixView<T>(mat, rows, cols, stride).block(i, j, r, c);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::block(size_t i, size_t j, size_t r, size_t c) const {
+    return MatrixView<const T>(mat, rows, cols, stride).block(i, j, r, c);
+}
+
+template <typename T>
+MatrixView<T> Matrix<T>::row(size_t i) {
+    return block(i, 0, 1, cols);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::row(size_t i) const {
+    return block(i, 0, 1, cols);
+}
+
+template <typename T>
+MatrixView<T> Matrix<T>::col(size_t j) {
+    return block(0, j, rows, 1);
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::col(size_t j) const {
+    return block(0, j, rows, 1);
+}
+
+template <typename T>
+MatrixView<T> Matrix<T>::transpose() {
+    return MatrixView<T>(mat, rows, cols, stride).transpose();
+}
+
+template <typename T>
+MatrixView<const T> Matrix<T>::transpose() const {
+    return MatrixView<const T>(mat, rows, cols, stride).transpose();
+}
+
+template <typename T>
+void Matrix<T>::transposeInPlace() {
+    if (rows == cols) {
+        layout::transposeInPlace(rows, mat, stride);
+    } else {
+        *this = transpose();
+    }
+}
+
+template <typename T>
+T Matrix<T>::determinant() const {
+    return LUDecomposition<T>(*this).determinant();
+}
+
+template <typename T>
+Matrix<T> Matrix<T>::inverse() const {
+    return LUDecomposition<T>(*this).inverse();
+}
+
+// ------------------ LU DEFINITIONS ------------------
+
+template <typename T>
+void LUDecomposition<T>::factorize() {
+    if (packed.getRows() != packed.getCols()) {
+        throw runtime_error("Error: Matrix must be square for LU decomposition!");
+    }
+    rowSwaps.resize(packed.getRows());
+    lu::factorize(packed.getRows(), packed.data(), packed.getStride(), rowSwaps.data());
+}
+
+template <typename T>
+bool LUDecomposition<T>::isSingular() const {
+    for (size_t i = 0; i < packed.getRows(); i++) {
+        if (packed(i, i) == T(0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+T LUDecomposition<T>::determinant() const {
+    // det(P) is -1 per interchange
+    T det = 1;
+    for (size_t i = 0; i < packed.getRows(); i++) {
+        det *= rowSwaps[i] != i ? -packed(i, i) : packed(i, i);
+    }
+    return det;
+}
+
+template <typename T>
+Matrix<T> LUDecomposition<T>::solve(const Matrix<T>& b) const {
+    if (b.getRows() != packed.getRows()) {
+        throw runtime_error("Error: Matrix sizes do not match for solve!");
+    }
+    if (isSingular()) {
+        throw runtime_error("Error: Cannot solve with a singular matrix!");
+    }
+    Matrix<T> x(b);
+    lu::solve(packed.getRows(), x.getCols(), packed.data(), packed.getStride(), rowSwaps.data(), x.data(), x.getStride());
+    return x;
+}
+
+template <typename T>
+Matrix<T> LUDecomposition<T>::inverse() const {
+    if (isSingular()) {
+        throw runtime_error("Error: Cannot invert a singular matrix!");
+    }
+    size_t n = packed.getRows();
+    Matrix<T> x(n, n);
+    for (size_t i = 0; i < n; i++) {
+        x(i, i) = 1;
+    }
+    lu::solve(n, n, packed.data(), packed.getStride(), rowSwaps.data(), x.data(), x.getStride());
+    return x;
+}
+
+// ------------------ VIEW DEFINITIONS ------------------
+
+template <typename T>
+MatrixView<T>& MatrixView<T>::operator=(const MatrixView& other) {
+    return *this = static_cast<const MatrixExpr<MatrixView>&>(other);
+}
+
+template <typename T>
+template <typename E>
+MatrixView<T>& MatrixView<T>::operator=(const MatrixExpr<E>& expr) {
+    static_assert(!std::is_const<T>::value, "Cannot assign through a read-only view");
+    const E& source = expr.self();
+    if (source.getRows() != rows || source.getCols() != cols) {
+        throw runtime_error("Error: Matrix sizes do not match for assignment!");
+    }
+    if (detail::conflicts(source, MatrixView<const T>(*this))) {
+        // e.g. a block assigned from an overlapping block, or a square view
+        // from its own transpose
+        Matrix<value_type> result(source);
+        detail::copyElements(detail::constView(result), *this);
+    } else if constexpr (IsStridedLeaf<E>::value) {
+        detail::copyElements(detail::constView(source), *this);
+    } else {
+        source.evalTo(*this);
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename E>
+MatrixView<T>& MatrixView<T>::operator+=(const MatrixExpr<E>& expr) {
+    if constexpr (IsProduct<E>::value) {
+        expr.self().addTo(detail::writableView(*this), value_type(1));
+    } else {
+        *this = *this + expr;
+    }
+    return *this;
+}
+
+template <typename T>
+template <typename E>
+MatrixView<T>& MatrixView<T>::operator-=(const MatrixExpr<E>& expr) {
+    if constexpr (IsProduct<E>::value) {
+        expr.self().addTo(detail::writableView(*this), value_type(-1));
+    } else {
+        *this = *this - expr;
+    }
+    return *this;
+}
+
+template <typename T>
+MatrixView<T>& MatrixView<T>::operator*=(value_type scalar) {
+    static_assert(!std::is_const<T>::value, "Cannot assign through a read-only view");
+    for (size_t i = 0; i < rows; i++) {
+        if (colStride == 1) {
+            simd::scale(scalar, &(*this)(i, 0), cols);
+        } else {
+            for (size_t j = 0; j < cols; j++) {
+                (*this)(i, j) *= scalar;
+            }
+        }
+    }
+    return *this;
+}
+
+template <typename T>
+typename MatrixView<T>::value_type MatrixView<T>::getElement(size_t i, size_t j) const {
+    if (i >= rows || j >= cols) {
+        throw std::out_of_range("Matrix index out of range");
+    }
+    return (*this)(i, j);
+}
+
+template <typename T>
+MatrixView<T> MatrixView<T>::block(size_t i, size_t j, size_t r, size_t c) const {
+    if (i + r > rows || j + c > cols) {
+        throw std::out_of_range("Matrix block out of range");
+    }
+    return MatrixView(ptr + i * rowStride + j * colStride, r, c, rowStride, colStride);
+}
+
+template <typename T>
+void MatrixView<T>::evalTo(Matrix<value_type>& dst) const {
+    // A view of dst itself, as in m = m.transpose(), is copied out first
+    if (detail::overlaps(*this, dst)) {
+        Matrix<value_type> result(rows, cols, dst.resultResource(rows, cols));
+        evalTo(result);
+        dst = std::move(result);
+        return;
+    }
+    dst.reshape(rows, cols);
+    detail::copyElements(MatrixView<const value_type>(*this),
+                         MatrixView<value_type>(dst.mat, rows, cols, dst.stride));
+}
+
 // Shearing
 template <typename T>
 ShearMatrix<T>::ShearMatrix(size_t m, size_t n, T shearX, T shearY)
 : Matrix<T>(m, n) {
     // Initialize identity matrix
     for (size_t i = 0; i < m && i < n; i++) {
-        this->mat[i][i] = 1;
+        (*this)(i, i) = 1;
     }
    
     if (m >= 2 && n >= 2) {
-        this->mat[0][1] = shearX;
-        this->mat[1][0] = shearY;
+        (*this)(0, 1) = shearX;
+        (*this)(1, 0) = shearY;
     }
 }
 
@@ -322,10 +1601,10 @@ template <typename T>
 RotateMatrix<T>::RotateMatrix(T angle)
 : Matrix<T>(2, 2) {
     T radians = (PI / 180) * angle;
-    this->mat[0][0] = cos(radians);
-    this->mat[0][1] = -sin(radians);
-    this->mat[1][0] = sin(radians);
-    this->mat[1][1] = cos(radians);
+    (*this)(0, 0) = cos(radians);
+    (*this)(0, 1) = -sin(radians);
+    (*this)(1, 0) = sin(radians);
+    (*this)(1, 1) = cos(radians);
 }
 
 template <typename T>
@@ -341,13 +1620,13 @@ ScaleMatrix<T>::ScaleMatrix(size_t m, size_t n, T scaleX, T scaleY)
     // Initialize to zeros
     for (size_t i = 0; i < m; i++) {
         for (size_t j = 0; j < n; j++) {
-            this->mat[i][j] = 0;
+            (*this)(i, j) = 0;
         }
     }
    
     if (m >= 2 && n >= 2) {
-        this->mat[0][0] = scaleX;
-        this->mat[1][1] = scaleY;
+        (*this)(0, 0) = scaleX;
+        (*this)(1, 1) = scaleY;
     }
 }
 
@@ -364,19 +1643,19 @@ ReflectMatrix<T>::ReflectMatrix(size_t m, size_t n, bool reflectX, bool reflectY
     // Initialize to zeros first
     for (size_t i = 0; i < m; i++) {
         for (size_t j = 0; j < n; j++) {
-            this->mat[i][j] = 0;
+            (*this)(i, j) = 0;
         }
     }
    
     // Set diagonal elements
     for (size_t i = 0; i < m && i < n; i++) {
-        this->mat[i][i] = 1;
+        (*this)(i, i) = 1;
     }
    
     // Apply reflection
     if (m >= 2 && n >= 2) {
-        this->mat[0][0] = reflectX ? -1 : 1;
-        this->mat[1][1] = reflectY ? -1 : 1;
+        (*this)(0, 0) = reflectX ? -1 : 1;
+        (*this)(1, 1) = reflectY ? -1 : 1;
     }
 }
 
@@ -386,4 +1665,126 @@ void ReflectMatrix<T>::transform() {
     this->display();
 }
 
-#endif // MATRIX_HPP
\ No newline at end of file
+// ------------------ FIXED-SIZE DEFINITIONS ------------------
+
+template <typename T, size_t R, size_t C>
+void Matrix<T, R, C>::inputMatrix() {
+    cout << "Enter elements of " << R << "x" << C << " matrix (row-wise):\n";
+    for (size_t i = 0; i < R; i++) {
+        for (size_t j = 0; j < C; j++) {
+            cin >> (*this)(i, j);
+        }
+    }
+}
+
+template <typename T, size_t R, size_t C>
+void Matrix<T, R, C>::display() const {
+    for (size_t i = 0; i < R; i++) {
+        for (size_t j = 0; j < C; j++) {
+            cout << (*this)(i, j) << " ";
+        }
+        cout << endl;
+    }
+}
+
+template <typename T, size_t R, size_t C>
+constexpr T Matrix<T, R, C>::getElement(size_t i, size_t j) const {
+    if (i >= R || j >= C) {
+        throw std::out_of_range("Matrix index out of range");
+    }
+    return (*this)(i, j);
+}
+
+template <typename T, size_t R, size_t C>
+constexpr void Matrix<T, R, C>::setElement(size_t i, size_t j, T value) {
+    if (i >= R || j >= C) {
+        throw std::out_of_range("Matrix index out of range");
+    }
+    (*this)(i, j) = value;
+}
+
+template <typename T, size_t R, size_t C>
+constexpr Matrix<T, R, C> Matrix<T, R, C>::projection(const Matrix<T, R, C>& vec1, const Matrix<T, R, C>& vec2) {
+    static_assert(C == 1 && R >= 2, "Error: Both matrices must be column vectors for projection!");
+
+    T dotProduct = 0;
+    T magnitudeSquared = 0;
+    for (size_t i = 0; i < R; i++) {
+        dotProduct += vec1(i, 0) * vec2(i, 0);
+        magnitudeSquared += vec1(i, 0) * vec1(i, 0);
+    }
+
+    if (magnitudeSquared == 0) {
+        throw runtime_error("Error: Cannot project onto a zero vector!");
+    }
+
+    T scalarProj = dotProduct / magnitudeSquared;
+    Matrix<T, R, C> result;
+    for (size_t i = 0; i < R; i++) {
+        result(i, 0) = vec1(i, 0) * scalarProj;
+    }
+    return result;
+}
+
+// Shearing
+template <typename T, size_t N>
+constexpr ShearMatrix<T, N>::ShearMatrix(T shearX, T shearY) : Matrix<T, N, N>() {
+    for (size_t i = 0; i < N; i++) {
+        (*this)(i, i) = 1;
+    }
+    (*this)(0, 1) = shearX;
+    (*this)(1, 0) = shearY;
+}
+
+template <typename T, size_t N>
+void ShearMatrix<T, N>::transform() {
+    cout << "Shearing Matrix:\n";
+    this->display();
+}
+
+// Rotation
+template <typename T, size_t N>
+RotateMatrix<T, N>::RotateMatrix(T angle) : Matrix<T, N, N>() {
+    T radians = (PI / 180) * angle;
+    (*this)(0, 0) = cos(radians);
+    (*this)(0, 1) = -sin(radians);
+    (*this)(1, 0) = sin(radians);
+    (*this)(1, 1) = cos(radians);
+}
+
+template <typename T, size_t N>
+void RotateMatrix<T, N>::transform() {
+    cout << "Rotation Matrix:\n";
+    this->display();
+}
+
+// Scaling
+template <typename T, size_t N>
+constexpr ScaleMatrix<T, N>::ScaleMatrix(T scaleX, T scaleY) : Matrix<T, N, N>() {
+    (*this)(0, 0) = scaleX;
+    (*this)(1, 1) = scaleY;
+}
+
+template <typename T, size_t N>
+void ScaleMatrix<T, N>::transform() {
+    cout << "Scaling Matrix:\n";
+    this->display();
+}
+
+// Reflection
+template <typename T, size_t N>
+constexpr ReflectMatrix<T, N>::ReflectMatrix(bool reflectX, bool reflectY) : Matrix<T, N, N>() {
+    for (size_t i = 0; i < N; i++) {
+        (*this)(i, i) = 1;
+    }
+    (*this)(0, 0) = reflectX ? -1 : 1;
+    (*this)(1, 1) = reflectY ? -1 : 1;
+}
+
+template <typename T, size_t N>
+void ReflectMatrix<T, N>::transform() {
+    cout << "Reflection Matrix:\n";
+    this->display();
+}
+
+#endif // MATRIX_HPP
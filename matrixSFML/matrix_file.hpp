@@ -0,0 +1,306 @@
+#ifndef MATRIX_FILE_HPP
+#define MATRIX_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matrix.hpp"
+
+// Binary matrix files that load by mapping them into memory. A file is a
+// 64-byte header followed, at an aligned offset, by the raw elements:
+//
+//     offset  size  field
+//          0     8  magic "MATRIXB\0"
+//          8     4  version (1)
+//         12     4  byte order mark 0x01020304, as written by the saving machine
+//         16     4  element type (matrix_file::Dtype)
+//         20     4  layout: 0 row-major, 1 column-major
+//         24     4  alignment of the data offset, in bytes
+//         28     4  reserved, 0
+//         32     8  rows
+//         40     8  cols
+//         48     8  stride: elements between consecutive rows (columns
+//                   when column-major)
+//         56     8  data offset
+//
+// Elements are stored in the byte order of the machine that saved them; a
+// file from a machine of the other byte order is rejected.
+//
+// mmapLoad maps the file copy-on-write and reads nothing but the header,
+// so opening a file of any size costs a system call or two; the pages are
+// read in as the elements are first touched. The matrices and views it
+// gives out are backed by the mapped pages directly:
+//
+//     matrix_file::save("points.mat", m);
+//     auto file = matrix_file::mmapLoad<float>("points.mat");
+//     Matrix<float> a = file.matrix();           // no copy
+//     Matrix<float> b = a * file.view().transpose();
+//
+// Writes to them stay in memory and never reach the file; save() again to
+// keep them. A result of their shape is written into the mapped pages,
+// even one that reads them, as in m = m * b. Like the matrices of a MatrixArena, they must not outlive the
+// MappedMatrix they came from. A column-major file only gives out views;
+// Matrix<T>(file.view()) copies it into a row-major matrix.
+namespace matrix_file {
+
+constexpr uint32_t version = 1;
+constexpr uint32_t byteOrderMark = 0x01020304;
+
+// Data starts on a page boundary, so every mapped element is aligned for
+// the vector kernels
+constexpr uint32_t dataAlignment = 4096;
+
+enum class Dtype : uint32_t {
+    Float32 = 1, Float64 = 2,
+    Int8 = 3, Int16 = 4, Int32 = 5, Int64 = 6,
+    UInt8 = 7, UInt16 = 8, UInt32 = 9, UInt64 = 10
+};
+
+enum class Layout : uint32_t { RowMajor = 0, ColMajor = 1 };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    Dtype dtype;
+    Layout layout;
+    uint32_t alignment;
+    uint32_t reserved;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t stride;
+    uint64_t dataOffset;
+};
+
+static_assert(sizeof(Header) == 64, "Error: Matrix file header must be 64 bytes!");
+
+constexpr char magic[8] = {'M', 'A', 'T', 'R', 'I', 'X', 'B', '\0'};
+
+// The file type of each element type that can be saved
+template <typename T>
+struct DtypeOf;
+
+template <> struct DtypeOf<float> : std::integral_constant<Dtype, Dtype::Float32> {};
+template <> struct DtypeOf<double> : std::integral_constant<Dtype, Dtype::Float64> {};
+template <> struct DtypeOf<int8_t> : std::integral_constant<Dtype, Dtype::Int8> {};
+template <> struct DtypeOf<int16_t> : std::integral_constant<Dtype, Dtype::Int16> {};
+template <> struct DtypeOf<int32_t> : std::integral_constant<Dtype, Dtype::Int32> {};
+template <> struct DtypeOf<int64_t> : std::integral_constant<Dtype, Dtype::Int64> {};
+template <> struct DtypeOf<uint8_t> : std::integral_constant<Dtype, Dtype::UInt8> {};
+template <> struct DtypeOf<uint16_t> : std::integral_constant<Dtype, Dtype::UInt16> {};
+template <> struct DtypeOf<uint32_t> : std::integral_constant<Dtype, Dtype::UInt32> {};
+template <> struct DtypeOf<uint64_t> : std::integral_constant<Dtype, Dtype::UInt64> {};
+
+// Writes the elements of m to path, replacing the file. A view whose
+// columns are contiguous (a transpose, say) is written column-major
+// without reordering; any other layout is written row-major.
+template <typename T>
+void save(const std::string& path, MatrixView<const T> m);
+
+template <typename T>
+void save(const std::string& path, MatrixView<T> m) {
+    save(path, MatrixView<const T>(m));
+}
+
+template <typename T>
+void save(const std::string& path, const Matrix<T>& m) {
+    save(path, detail::constView(m));
+}
+
+// A matrix file mapped into memory. It is also the memory resource of the
+// matrices it gives out: their buffer is the mapping, which it keeps until
+// it is destroyed, and anything they allocate after a reshape comes from
+// upstream.
+template <typename T>
+class MappedMatrix : public std::pmr::memory_resource {
+public:
+    explicit MappedMatrix(const std::string& path,
+                          std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    ~MappedMatrix() override;
+
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+    const Header& header() const { return *static_cast<const Header*>(mapping); }
+    size_t getRows() const { return header().rows; }
+    size_t getCols() const { return header().cols; }
+    Layout layout() const { return header().layout; }
+
+    // The mapped elements; writing through the view changes only our copy
+    MatrixView<T> view();
+    MatrixView<const T> view() const;
+
+    // A matrix whose buffer is the mapped elements; throws for a
+    // column-major file
+    Matrix<T> matrix();
+
+private:
+    void* mapping;
+    size_t length;
+    T* elements;
+    std::pmr::memory_resource* upstream;
+
+    void* do_allocate(size_t bytes, size_t align) override { return upstream->allocate(bytes, align); }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        if (p != elements) {
+            upstream->deallocate(p, bytes, align);
+        }
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+// Maps the file at path, whose elements must be of type T
+template <typename T>
+MappedMatrix<T> mmapLoad(const std::string& path) {
+    return MappedMatrix<T>(path);
+}
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T>
+void save(const std::string& path, MatrixView<const T> m) {
+    static_assert(std::is_arithmetic<T>::value, "Error: Only arithmetic matrices can be saved!");
+    // Columns are written out as the rows of the transpose
+    bool colMajor = m.getColStride() != 1 && m.getStride() == 1 && m.getRows() > 1;
+    MatrixView<const T> lines = colMajor ? m.transpose() : m;
+
+    Header header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.dtype = DtypeOf<T>::value;
+    header.layout = colMajor ? Layout::ColMajor : Layout::RowMajor;
+    header.alignment = dataAlignment;
+    header.rows = m.getRows();
+    header.cols = m.getCols();
+    header.stride = lines.getCols();
+    header.dataOffset = dataAlignment;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw runtime_error("Error: Cannot open " + path + " for writing!");
+    }
+    std::vector<char> padding(header.dataOffset - sizeof(Header));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    out.write(padding.data(), padding.size());
+
+    size_t n = lines.getCols();
+    if (lines.getColStride() == 1 && lines.getStride() == n) {
+        out.write(reinterpret_cast<const char*>(lines.data()), lines.getRows() * n * sizeof(T));
+    } else if (lines.getColStride() == 1) {
+        for (size_t i = 0; i < lines.getRows(); i++) {
+            out.write(reinterpret_cast<const char*>(&lines(i, 0)), n * sizeof(T));
+        }
+    } else {
+        std::vector<T> line(n);
+        for (size_t i = 0; i < lines.getRows(); i++) {
+            for (size_t j = 0; j < n; j++) {
+                line[j] = lines(i, j);
+            }
+            out.write(reinterpret_cast<const char*>(line.data()), n * sizeof(T));
+        }
+    }
+    if (!out.flush()) {
+        throw runtime_error("Error: Cannot write " + path + "!");
+    }
+}
+
+template <typename T>
+MappedMatrix<T>::MappedMatrix(const std::string& path, std::pmr::memory_resource* upstream)
+: mapping(nullptr), length(0), elements(nullptr), upstream(upstream) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Error: Cannot open " + path + "!");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        throw runtime_error("Error: " + path + " is not a matrix file!");
+    }
+    // Private and writable: pages we write to are copied, the file is not
+    length = size_t(info.st_size);
+    mapping = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw runtime_error("Error: Cannot map " + path + "!");
+    }
+
+    const Header& h = header();
+    const char* problem = nullptr;
+    if (std::memcmp(h.magic, magic, sizeof(magic)) != 0) {
+        problem = "is not a matrix file";
+    } else if (h.version > version) {
+        problem = "has an unsupported version";
+    } else if (h.byteOrder != byteOrderMark) {
+        problem = "was saved with the other byte order";
+    } else if (h.dtype != DtypeOf<T>::value) {
+        problem = "holds a different element type";
+    } else if (h.layout != Layout::RowMajor && h.layout != Layout::ColMajor) {
+        problem = "has an unknown layout";
+    } else {
+        // Lines of width elements, stride elements apart, all present
+        uint64_t lines = h.layout == Layout::RowMajor ? h.rows : h.cols;
+        uint64_t width = h.layout == Layout::RowMajor ? h.cols : h.rows;
+        uint64_t available = h.dataOffset <= length ? (length - h.dataOffset) / sizeof(T) : 0;
+        bool fits = lines == 0 || width == 0 || (h.stride >= width && lines <= available / h.stride);
+        if (h.dataOffset < sizeof(Header) || h.dataOffset % alignof(T) != 0 || !fits) {
+            problem = "is truncated or corrupt";
+        }
+    }
+    if (problem) {
+        ::munmap(mapping, length);
+        mapping = nullptr;
+        throw runtime_error("Error: " + path + " " + problem + "!");
+    }
+    elements = reinterpret_cast<T*>(static_cast<char*>(mapping) + h.dataOffset);
+}
+
+template <typename T>
+MappedMatrix<T>::~MappedMatrix() {
+    if (mapping) {
+        ::munmap(mapping, length);
+    }
+}
+
+template <typename T>
+MatrixView<T> MappedMatrix<T>::view() {
+    if (layout() == Layout::ColMajor) {
+        return MatrixView<T>(elements, getRows(), getCols(), 1, header().stride);
+    }
+    return MatrixView<T>(elements, getRows(), getCols(), header().stride);
+}
+
+template <typename T>
+MatrixView<const T> MappedMatrix<T>::view() const {
+    return const_cast<MappedMatrix<T>*>(this)->view();
+}
+
+template <typename T>
+Matrix<T> MappedMatrix<T>::matrix() {
+    if (layout() != Layout::RowMajor) {
+        throw runtime_error("Error: Only a row-major matrix file maps to a Matrix!");
+    }
+    if (getRows() == 0 || getCols() == 0) {
+        return Matrix<T>(this);
+    }
+    return Matrix<T>(getRows(), getCols(), header().stride, elements, this);
+}
+
+} // namespace matrix_file
+
+#endif // MATRIX_FILE_HPP
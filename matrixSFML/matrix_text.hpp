@@ -0,0 +1,346 @@
+#ifndef MATRIX_TEXT_HPP
+#define MATRIX_TEXT_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "matrix.hpp"
+#include "thread_pool.hpp"
+
+// Numeric text matrices: one row per line, values separated by spaces,
+// tabs or commas, so whitespace-separated, CSV and TSV files all read the
+// same way. Blank lines are skipped and every other line must have as
+// many values as the first.
+//
+// Values are parsed with std::from_chars, straight from the text into the
+// destination, without streams or locales:
+//
+//     Matrix<double> a = matrix_text::load<double>("a.csv");
+//     Eigen::MatrixXd b;
+//     matrix_text::load("b.txt", b);  // any Eigen dense matrix, resized
+//
+// load() maps the file and parses it in place; large files are split at
+// line boundaries and parsed on the thread pool. read() takes any stream
+// and parses it a chunk at a time as it arrives. Any dense type with
+// resize(), data(), rowStride() and colStride(), as Eigen's are, can be
+// filled in place of a Matrix<T>.
+namespace matrix_text {
+
+// Bytes read from a stream at a time
+constexpr size_t chunkSize = 1 << 20;
+
+// Texts at least this long are parsed in parallel
+constexpr size_t parallelThreshold = 1 << 20;
+
+namespace detail {
+
+inline bool isSeparator(char c) {
+    constexpr uint64_t separators = 1ull << ' ' | 1ull << ',' | 1ull << '\t' | 1ull << '\r';
+    return unsigned(c) < 64 && (separators >> c & 1);
+}
+
+// The end of the line starting at p: its newline, or end
+inline const char* lineEnd(const char* p, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    return newline ? newline : end;
+}
+
+inline bool isBlank(const char* p, const char* end) {
+    while (p != end && isSeparator(*p)) {
+        p++;
+    }
+    return p == end;
+}
+
+// Values on the line [p, end)
+inline size_t countValues(const char* p, const char* end) {
+    size_t count = 0;
+    while (true) {
+        while (p != end && isSeparator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            return count;
+        }
+        count++;
+        while (p != end && !isSeparator(*p)) {
+            p++;
+        }
+    }
+}
+
+// Non-blank lines in [p, end)
+inline size_t countRows(const char* p, const char* end) {
+    size_t rows = 0;
+    while (p != end) {
+        const char* e = lineEnd(p, end);
+        rows += !isBlank(p, e);
+        p = e == end ? end : e + 1;
+    }
+    return rows;
+}
+
+[[noreturn]] inline void rowError(size_t row, const char* problem) {
+    throw runtime_error("Error: Row " + std::to_string(row + 1) + " " + problem + "!");
+}
+
+// Parses the cols values of the line [p, end) into out, colStride apart
+template <typename T>
+void parseRow(const char* p, const char* end, T* out, size_t colStride, size_t cols, size_t row) {
+    for (size_t j = 0; j < cols; j++) {
+        while (p != end && isSeparator(*p)) {
+            p++;
+        }
+        if (p == end) {
+            rowError(row, "has too few values");
+        }
+        // from_chars takes a minus sign but not a plus
+        if (*p == '+' && end - p > 1 && *(p + 1) != '-') {
+            p++;
+        }
+        auto [next, ec] = std::from_chars(p, end, out[j * colStride]);
+        if (ec != std::errc() || (next != end && !isSeparator(*next))) {
+            rowError(row, "has an invalid number");
+        }
+        p = next;
+    }
+    if (!isBlank(p, end)) {
+        rowError(row, "has too many values");
+    }
+}
+
+// Parses the non-blank lines of [p, end) into consecutive rows of dst,
+// starting at row first
+template <typename T>
+void parseRows(const char* p, const char* end, MatrixView<T> dst, size_t first) {
+    size_t row = first;
+    while (p != end) {
+        const char* e = lineEnd(p, end);
+        if (!isBlank(p, e)) {
+            if (row == dst.getRows()) {
+                throw runtime_error("Error: Text has more rows than the matrix!");
+            }
+            parseRow(p, e, &dst(row, 0), dst.getColStride(), dst.getCols(), row);
+            row++;
+        }
+        p = e == end ? end : e + 1;
+    }
+}
+
+// Cuts [begin, end) into about pieces parts that each end after a newline
+inline std::vector<const char*> splitLines(const char* begin, const char* end, size_t pieces) {
+    std::vector<const char*> bounds{begin};
+    size_t step = (end - begin) / pieces + 1;
+    while (end - bounds.back() > ptrdiff_t(step)) {
+        const char* cut = lineEnd(bounds.back() + step, end);
+        bounds.push_back(cut == end ? end : cut + 1);
+    }
+    if (bounds.back() != end) {
+        bounds.push_back(end);
+    }
+    return bounds;
+}
+
+// Calls fill(rows, cols) for a destination of the shape of the text, then
+// parses the text into the view it returns
+template <typename T, typename Fill>
+void parseText(std::string_view text, const Fill& fill) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    // The first non-blank line gives the number of columns
+    const char* first = begin;
+    size_t cols = 0;
+    while (first != end && cols == 0) {
+        const char* e = lineEnd(first, end);
+        cols = countValues(first, e);
+        if (cols == 0) {
+            first = e == end ? end : e + 1;
+        }
+    }
+
+    if (!parallel::worthSplitting(text.size(), parallelThreshold)) {
+        MatrixView<T> dst = fill(countRows(first, end), cols);
+        parseRows(first, end, dst, 0);
+        return;
+    }
+
+    // Count the rows of each piece, then parse the pieces into the rows
+    // that follow those of the pieces before them
+    std::vector<const char*> bounds = splitLines(first, end, 4 * parallel::threadCount());
+    size_t pieces = bounds.size() - 1;
+    std::vector<size_t> starts(pieces + 1, 0);
+    parallel::parallelFor(pieces, [&](size_t k) { starts[k + 1] = countRows(bounds[k], bounds[k + 1]); });
+    for (size_t k = 0; k < pieces; k++) {
+        starts[k + 1] += starts[k];
+    }
+    MatrixView<T> dst = fill(starts[pieces], cols);
+    parallel::parallelFor(pieces, [&](size_t k) { parseRows(bounds[k], bounds[k + 1], dst, starts[k]); });
+}
+
+// The lines of a stream, a chunk at a time, appended to values row by row
+template <typename T>
+size_t readValues(std::istream& in, std::vector<T>& values, size_t& cols) {
+    std::string buffer;
+    size_t kept = 0; // bytes of an unfinished line carried over
+    size_t rows = 0;
+    bool more = true;
+    while (more) {
+        buffer.resize(kept + chunkSize);
+        in.read(&buffer[kept], chunkSize);
+        size_t length = kept + size_t(in.gcount());
+        more = bool(in);
+
+        // Parse up to the last newline, or everything at the end
+        const char* p = buffer.data();
+        const char* end = p + length;
+        if (more) {
+            while (end != p && *(end - 1) != '\n') {
+                end--;
+            }
+        }
+        while (p != end) {
+            const char* e = lineEnd(p, end);
+            if (!isBlank(p, e)) {
+                if (rows == 0) {
+                    cols = countValues(p, e);
+                }
+                values.resize(values.size() + cols);
+                parseRow(p, e, values.data() + rows * cols, size_t(1), cols, rows);
+                rows++;
+            }
+            p = e == end ? end : e + 1;
+        }
+        kept = buffer.data() + length - end;
+        std::memmove(&buffer[0], end, kept);
+    }
+    if (in.bad()) {
+        throw runtime_error("Error: Cannot read the matrix text!");
+    }
+    return rows;
+}
+
+// The file at path mapped read-only for the duration of a call
+template <typename F>
+void withMappedFile(const std::string& path, const F& body) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw runtime_error("Error: Cannot open " + path + "!");
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw runtime_error("Error: Cannot read " + path + "!");
+    }
+    size_t length = size_t(info.st_size);
+    if (length == 0) {
+        ::close(fd);
+        body(std::string_view());
+        return;
+    }
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw runtime_error("Error: Cannot map " + path + "!");
+    }
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+    try {
+        body(std::string_view(static_cast<const char*>(mapping), length));
+    } catch (...) {
+        ::munmap(mapping, length);
+        throw;
+    }
+    ::munmap(mapping, length);
+}
+
+// Views of the destinations, resized to rows x cols
+template <typename T>
+MatrixView<T> resized(Matrix<T>& dst, size_t rows, size_t cols) {
+    if (dst.getRows() != rows || dst.getCols() != cols) {
+        dst = Matrix<T>(rows, cols, dst.getResource());
+    }
+    return ::detail::writableView(dst);
+}
+
+template <typename Dense>
+MatrixView<typename Dense::Scalar> resized(Dense& dst, size_t rows, size_t cols) {
+    dst.resize(rows, cols);
+    return MatrixView<typename Dense::Scalar>(dst.data(), rows, cols, dst.rowStride(), dst.colStride());
+}
+
+template <typename M>
+struct ScalarOf {
+    using type = typename M::Scalar;
+};
+
+template <typename T>
+struct ScalarOf<Matrix<T>> {
+    using type = T;
+};
+
+} // namespace detail
+
+// Parses text into dst, which takes its shape
+template <typename M>
+void parse(std::string_view text, M& dst) {
+    using T = typename detail::ScalarOf<M>::type;
+    detail::parseText<T>(text, [&](size_t rows, size_t cols) { return detail::resized(dst, rows, cols); });
+}
+
+template <typename T>
+Matrix<T> parse(std::string_view text) {
+    Matrix<T> result;
+    parse(text, result);
+    return result;
+}
+
+// Reads the text of a stream until it ends
+template <typename M>
+void read(std::istream& in, M& dst) {
+    using T = typename detail::ScalarOf<M>::type;
+    std::vector<T> values;
+    size_t cols = 0;
+    size_t rows = detail::readValues(in, values, cols);
+    MatrixView<T> view = detail::resized(dst, rows, cols);
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t j = 0; j < cols; j++) {
+            view(i, j) = values[i * cols + j];
+        }
+    }
+}
+
+template <typename T>
+Matrix<T> read(std::istream& in) {
+    Matrix<T> result;
+    read(in, result);
+    return result;
+}
+
+// Reads the text file at path
+template <typename M>
+void load(const std::string& path, M& dst) {
+    detail::withMappedFile(path, [&](std::string_view text) { parse(text, dst); });
+}
+
+template <typename T>
+Matrix<T> load(const std::string& path) {
+    Matrix<T> result;
+    load(path, result);
+    return result;
+}
+
+} // namespace matrix_text
+
+#endif // MATRIX_TEXT_HPP
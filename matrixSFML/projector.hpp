@@ -0,0 +1,224 @@
+#ifndef PROJECTOR_HPP
+#define PROJECTOR_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+#include "vector_set.hpp"
+
+// Projection onto one fixed axis a, for projecting many vectors onto it.
+// Matrix<T>::projection(a, v) computes a . a and divides on every call;
+// here 1 / (a . a) is computed once, and a whole VectorSet is projected
+// in one pass that reads each component once and writes into a set the
+// caller owns:
+//
+//     Projector<float> onX(xAxis), onY(yAxis);
+//     onX.project(points, alongX); // alongX[i] = (a . v_i) / (a . a) * a
+//     onY.coefficients(points, t); // t[i] = (a . v_i) / (a . a)
+//
+// Results match Matrix<T>::projection up to the rounding of the
+// multiplication by 1 / (a . a) in place of the division.
+template <typename T>
+class Projector {
+public:
+    // axis is a column vector with at least two rows, as for projection()
+    explicit Projector(const Matrix<T>& axis);
+    template <size_t N>
+    explicit Projector(const Matrix<T, N, 1>& axis);
+
+    size_t getDims() const { return direction.size(); }
+    const T* axis() const { return direction.data(); }
+    T inverseNormSquared() const { return inverseNorm; }
+
+    // Matrix<T>::projection(axis, vec), without its per-call division
+    Matrix<T> project(const Matrix<T>& vec) const;
+
+    // Writes the projection of every vector of in to out, which must have
+    // the same shape; out may be in
+    void project(const VectorSet<T>& in, VectorSet<T>& out) const;
+
+    // Writes (a . v) / (a . a) for every vector v of in to out[0 .. in.size())
+    void coefficients(const VectorSet<T>& in, T* out) const;
+
+private:
+    std::vector<T> direction;
+    T inverseNorm;
+
+    void initialize();
+};
+
+// ------------------ KERNELS ------------------
+
+namespace detail {
+
+// For points [begin, end): the coefficient s = (a . v) * inverseNorm and,
+// if out isn't null, the projection s * a, or else s itself into coeffs.
+// V is either T itself or a vector of T; every component of a point is
+// read before anything is stored, so out may alias in.
+template <typename V, typename T>
+SIMD_INLINE void projectPoints(size_t dims, const T* axis, T inverseNorm, const T* const* in, T* const* out,
+                               T* coeffs, size_t begin, size_t end) {
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        V x;
+        std::memcpy(&x, in[0] + i, sizeof(V));
+        V s = axis[0] * x;
+        for (size_t c = 1; c < dims; c++) {
+            std::memcpy(&x, in[c] + i, sizeof(V));
+            s += axis[c] * x;
+        }
+        s *= inverseNorm;
+        if (out) {
+            for (size_t c = 0; c < dims; c++) {
+                V p = axis[c] * s;
+                std::memcpy(out[c] + i, &p, sizeof(V));
+            }
+        } else {
+            std::memcpy(coeffs + i, &s, sizeof(V));
+        }
+    }
+    if constexpr (W > 1) {
+        projectPoints<T>(dims, axis, inverseNorm, in, out, coeffs, i, end);
+    }
+}
+
+#if SIMD_X86
+template <typename T>
+SIMD_TARGET_AVX2 void projectPointsAvx2(size_t dims, const T* axis, T inverseNorm, const T* const* in,
+                                        T* const* out, T* coeffs, size_t begin, size_t end) {
+    projectPoints<typename simd::VectorType<T, 32>::type>(dims, axis, inverseNorm, in, out, coeffs, begin, end);
+}
+
+template <typename T>
+SIMD_TARGET_AVX512 void projectPointsAvx512(size_t dims, const T* axis, T inverseNorm, const T* const* in,
+                                            T* const* out, T* coeffs, size_t begin, size_t end) {
+    projectPoints<typename simd::VectorType<T, 64>::type>(dims, axis, inverseNorm, in, out, coeffs, begin, end);
+}
+#endif
+
+template <typename T>
+void projectRange(size_t dims, const T* axis, T inverseNorm, const T* const* in, T* const* out, T* coeffs,
+                  size_t begin, size_t end) {
+    if constexpr (simd::isVectorizable<T> && simd::hasBaselineVector<T>) {
+        switch (simd::activeIsa()) {
+#if SIMD_X86
+        case simd::Isa::AVX512: projectPointsAvx512(dims, axis, inverseNorm, in, out, coeffs, begin, end); return;
+        case simd::Isa::AVX2: projectPointsAvx2(dims, axis, inverseNorm, in, out, coeffs, begin, end); return;
+#endif
+        case simd::Isa::Baseline:
+            projectPoints<typename simd::BaselineVector<T>::type>(dims, axis, inverseNorm, in, out, coeffs, begin, end);
+            return;
+        default: break;
+        }
+    }
+    projectPoints<T>(dims, axis, inverseNorm, in, out, coeffs, begin, end);
+}
+
+// Projects every vector of in into out or, with out null, into coeffs
+template <typename T>
+void projectSet(const T* axis, T inverseNorm, const VectorSet<T>& in, VectorSet<T>* out, T* coeffs) {
+    size_t dims = in.getDims();
+    std::vector<const T*> src(dims);
+    std::vector<T*> dst(out ? dims : 0);
+    for (size_t d = 0; d < dims; d++) {
+        src[d] = in.component(d);
+        if (out) {
+            dst[d] = out->component(d);
+        }
+    }
+    T* const* outs = out ? dst.data() : nullptr;
+
+    // Cache-line aligned slices, a few per thread, as in transformSet
+    size_t count = in.size();
+    if (parallel::worthSplitting(count, vectorSetThreshold)) {
+        size_t slices = 4 * parallel::threadCount();
+        size_t slice = (count + slices - 1) / slices;
+        slice = (slice + 63) / 64 * 64;
+        parallel::parallelFor((count + slice - 1) / slice, [&](size_t s) {
+            projectRange(dims, axis, inverseNorm, src.data(), outs, coeffs, s * slice, std::min(count, (s + 1) * slice));
+        });
+    } else {
+        projectRange(dims, axis, inverseNorm, src.data(), outs, coeffs, size_t(0), count);
+    }
+}
+
+} // namespace detail
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T>
+Projector<T>::Projector(const Matrix<T>& axis) {
+    if (axis.getCols() != 1 || axis.getRows() < 2) {
+        throw runtime_error("Error: Both matrices must be column vectors for projection!");
+    }
+    direction.resize(axis.getRows());
+    for (size_t i = 0; i < axis.getRows(); i++) {
+        direction[i] = axis(i, 0);
+    }
+    initialize();
+}
+
+template <typename T>
+template <size_t N>
+Projector<T>::Projector(const Matrix<T, N, 1>& axis) : direction(axis.data(), axis.data() + N) {
+    static_assert(N >= 2, "Error: Both matrices must be column vectors for projection!");
+    initialize();
+}
+
+template <typename T>
+void Projector<T>::initialize() {
+    T magnitudeSquared = simd::dotAccumulated(direction.data(), direction.data(), direction.size());
+    if (magnitudeSquared == 0) {
+        throw runtime_error("Error: Cannot project onto a zero vector!");
+    }
+    inverseNorm = T(1) / magnitudeSquared;
+}
+
+template <typename T>
+Matrix<T> Projector<T>::project(const Matrix<T>& vec) const {
+    if (vec.getCols() != 1 || vec.getRows() != getDims()) {
+        throw runtime_error("Error: Both matrices must be column vectors for projection!");
+    }
+    T dotProduct;
+    if (vec.getStride() == 1) {
+        dotProduct = simd::dotAccumulated(direction.data(), vec.data(), getDims());
+    } else {
+        dotProduct = 0;
+        for (size_t i = 0; i < getDims(); i++) {
+            dotProduct += direction[i] * vec(i, 0);
+        }
+    }
+    T scalarProj = dotProduct * inverseNorm;
+    Matrix<T> result(getDims(), 1);
+    for (size_t i = 0; i < getDims(); i++) {
+        result(i, 0) = direction[i] * scalarProj;
+    }
+    return result;
+}
+
+template <typename T>
+void Projector<T>::project(const VectorSet<T>& in, VectorSet<T>& out) const {
+    if (in.getDims() != getDims()) {
+        throw runtime_error("Error: Vector set does not match the projection axis!");
+    }
+    if (out.getDims() != in.getDims() || out.size() != in.size()) {
+        throw runtime_error("Error: Vector sets must have the same shape!");
+    }
+    detail::projectSet(direction.data(), inverseNorm, in, &out, static_cast<T*>(nullptr));
+}
+
+template <typename T>
+void Projector<T>::coefficients(const VectorSet<T>& in, T* out) const {
+    if (in.getDims() != getDims()) {
+        throw runtime_error("Error: Vector set does not match the projection axis!");
+    }
+    detail::projectSet(direction.data(), inverseNorm, in, static_cast<VectorSet<T>*>(nullptr), out);
+}
+
+#endif // PROJECTOR_HPP
@@ -0,0 +1,1093 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <type_traits>
+
+// Vector kernels for the float and double hot loops, in one binary for every
+// CPU. Each kernel exists once per instruction set; the best one the CPU
+// supports is detected on first use and every call dispatches on it.
+//
+//   Scalar   - plain loops, the reference the others are checked against
+//   Baseline - 16-byte vectors: SSE2 on x86-64, NEON on ARM64
+//   AVX2     - 32-byte vectors with FMA (and F16C, which every AVX2 CPU has)
+//   AVX512   - 64-byte vectors with FMA
+//
+// Element-wise results, scale included, are bit-identical across
+// instruction sets. Dot products, axpy and the FMA product kernels round
+// differently from the scalar path, by a few ULP per accumulated term.
+//
+// How long sums accumulate is a separate, global setting: setAccumulation()
+// can have float products and projections summed in double, or with
+// compensation, while matrices stay float in memory.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SIMD_VECTOR_EXTENSIONS 1
+#define SIMD_INLINE __attribute__((always_inline)) inline
+#else
+#define SIMD_INLINE inline
+#endif
+
+#if SIMD_VECTOR_EXTENSIONS && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#define SIMD_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+namespace simd {
+
+enum class Isa { Scalar, Baseline, AVX2, AVX512 };
+
+inline const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::Baseline: return "baseline";
+    case Isa::AVX2: return "avx2";
+    case Isa::AVX512: return "avx512";
+    }
+    return "unknown";
+}
+
+// Best instruction set this CPU (and OS) supports
+inline Isa detectIsa() {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        return Isa::AVX2;
+    }
+    return __builtin_cpu_supports("sse2") ? Isa::Baseline : Isa::Scalar;
+#elif SIMD_VECTOR_EXTENSIONS
+    return Isa::Baseline;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+namespace detail {
+
+inline std::atomic<Isa>& currentIsa() {
+    static std::atomic<Isa> isa(detectIsa());
+    return isa;
+}
+
+} // namespace detail
+
+inline Isa activeIsa() {
+    return detail::currentIsa().load(std::memory_order_relaxed);
+}
+
+// Restricts the kernels to a lower instruction set, e.g. Isa::Scalar to
+// cross-check results. Requests above what the CPU supports are clamped.
+inline void setIsa(Isa isa) {
+    Isa best = detectIsa();
+    detail::currentIsa().store(isa < best ? isa : best, std::memory_order_relaxed);
+}
+
+// Rows shorter than this aren't worth a dispatch
+constexpr size_t scalarLimit = 16;
+
+// ------------------ SCALAR ------------------
+
+namespace scalar {
+
+template <typename T>
+void add(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] + b[i];
+    }
+}
+
+template <typename T>
+void sub(const T* a, const T* b, T* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = a[i] - b[i];
+    }
+}
+
+template <typename T>
+T dot(const T* a, const T* b, size_t n) {
+    T sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+template <typename T>
+void axpy(T alpha, const T* x, T* y, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        y[i] += alpha * x[i];
+    }
+}
+
+template <typename T>
+void scale(T alpha, T* x, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        x[i] *= alpha;
+    }
+}
+
+} // namespace scalar
+
+// ------------------ BASELINE (16-byte vectors) ------------------
+
+template <typename T>
+struct BaselineVector { using type = void; };
+
+#if SIMD_VECTOR_EXTENSIONS
+template <>
+struct BaselineVector<float> { typedef float type __attribute__((vector_size(16))); };
+
+template <>
+struct BaselineVector<double> { typedef double type __attribute__((vector_size(16))); };
+#endif
+
+template <typename T>
+constexpr bool hasBaselineVector = !std::is_void<typename BaselineVector<T>::type>::value;
+
+// Vector of any width, for kernels written once and compiled per
+// instruction set: called from an AVX2 or AVX-512 target function, the
+// 32- and 64-byte forms compile to single instructions
+#if SIMD_VECTOR_EXTENSIONS
+template <typename T, size_t Bytes>
+struct VectorType { typedef T type __attribute__((vector_size(Bytes))); };
+#endif
+
+namespace baseline {
+
+template <typename T>
+void add(const T* a, const T* b, T* out, size_t n) {
+    using V = typename BaselineVector<T>::type;
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V x, y;
+        std::memcpy(&x, a + i, sizeof(V));
+        std::memcpy(&y, b + i, sizeof(V));
+        x += y;
+        std::memcpy(out + i, &x, sizeof(V));
+    }
+    scalar::add(a + i, b + i, out + i, n - i);
+}
+
+template <typename T>
+void sub(const T* a, const T* b, T* out, size_t n) {
+    using V = typename BaselineVector<T>::type;
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V x, y;
+        std::memcpy(&x, a + i, sizeof(V));
+        std::memcpy(&y, b + i, sizeof(V));
+        x -= y;
+        std::memcpy(out + i, &x, sizeof(V));
+    }
+    scalar::sub(a + i, b + i, out + i, n - i);
+}
+
+template <typename T>
+T dot(const T* a, const T* b, size_t n) {
+    using V = typename BaselineVector<T>::type;
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    V acc0 = {}, acc1 = {};
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        V x0, y0, x1, y1;
+        std::memcpy(&x0, a + i, sizeof(V));
+        std::memcpy(&y0, b + i, sizeof(V));
+        std::memcpy(&x1, a + i + W, sizeof(V));
+        std::memcpy(&y1, b + i + W, sizeof(V));
+        acc0 += x0 * y0;
+        acc1 += x1 * y1;
+    }
+    acc0 += acc1;
+    T sum = 0;
+    for (size_t w = 0; w < W; w++) {
+        sum += acc0[w];
+    }
+    return sum + scalar::dot(a + i, b + i, n - i);
+}
+
+template <typename T>
+void axpy(T alpha, const T* x, T* y, size_t n) {
+    using V = typename BaselineVector<T>::type;
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V u, v;
+        std::memcpy(&u, x + i, sizeof(V));
+        std::memcpy(&v, y + i, sizeof(V));
+        v += alpha * u;
+        std::memcpy(y + i, &v, sizeof(V));
+    }
+    scalar::axpy(alpha, x + i, y + i, n - i);
+}
+
+template <typename T>
+void scale(T alpha, T* x, size_t n) {
+    using V = typename BaselineVector<T>::type;
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        V v;
+        std::memcpy(&v, x + i, sizeof(V));
+        v *= alpha;
+        std::memcpy(x + i, &v, sizeof(V));
+    }
+    scalar::scale(alpha, x + i, n - i);
+}
+
+} // namespace baseline
+
+// ------------------ AVX2 / AVX-512 ------------------
+
+#if SIMD_X86
+namespace avx2 {
+
+SIMD_TARGET_AVX2 inline void add(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    scalar::add(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void add(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    scalar::add(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void sub(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    scalar::sub(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void sub(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    }
+    scalar::sub(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline float dot(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+    float sum = 0;
+    for (float lane : lanes) {
+        sum += lane;
+    }
+    return sum + scalar::dot(a + i, b + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline double dot(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+    double sum = 0;
+    for (double lane : lanes) {
+        sum += lane;
+    }
+    return sum + scalar::dot(a + i, b + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void axpy(float alpha, const float* x, float* y, size_t n) {
+    __m256 a = _mm256_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(y + i, _mm256_fmadd_ps(a, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+    scalar::axpy(alpha, x + i, y + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void axpy(double alpha, const double* x, double* y, size_t n) {
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    scalar::axpy(alpha, x + i, y + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void scale(float alpha, float* x, size_t n) {
+    __m256 a = _mm256_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(a, _mm256_loadu_ps(x + i)));
+    }
+    scalar::scale(alpha, x + i, n - i);
+}
+
+SIMD_TARGET_AVX2 inline void scale(double alpha, double* x, size_t n) {
+    __m256d a = _mm256_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+    }
+    scalar::scale(alpha, x + i, n - i);
+}
+
+} // namespace avx2
+
+namespace avx512 {
+
+SIMD_TARGET_AVX512 inline void add(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    scalar::add(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void add(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    }
+    scalar::add(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void sub(const float* a, const float* b, float* out, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+    }
+    scalar::sub(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void sub(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+    }
+    scalar::sub(a + i, b + i, out + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline float dot(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    float lanes[16];
+    _mm512_storeu_ps(lanes, _mm512_add_ps(acc0, acc1));
+    float sum = 0;
+    for (float lane : lanes) {
+        sum += lane;
+    }
+    return sum + scalar::dot(a + i, b + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline double dot(const double* a, const double* b, size_t n) {
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+        acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+    }
+    double lanes[8];
+    _mm512_storeu_pd(lanes, _mm512_add_pd(acc0, acc1));
+    double sum = 0;
+    for (double lane : lanes) {
+        sum += lane;
+    }
+    return sum + scalar::dot(a + i, b + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void axpy(float alpha, const float* x, float* y, size_t n) {
+    __m512 a = _mm512_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(y + i, _mm512_fmadd_ps(a, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+    }
+    scalar::axpy(alpha, x + i, y + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void axpy(double alpha, const double* x, double* y, size_t n) {
+    __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(y + i, _mm512_fmadd_pd(a, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+    }
+    scalar::axpy(alpha, x + i, y + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void scale(float alpha, float* x, size_t n) {
+    __m512 a = _mm512_set1_ps(alpha);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(x + i, _mm512_mul_ps(a, _mm512_loadu_ps(x + i)));
+    }
+    scalar::scale(alpha, x + i, n - i);
+}
+
+SIMD_TARGET_AVX512 inline void scale(double alpha, double* x, size_t n) {
+    __m512d a = _mm512_set1_pd(alpha);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm512_storeu_pd(x + i, _mm512_mul_pd(a, _mm512_loadu_pd(x + i)));
+    }
+    scalar::scale(alpha, x + i, n - i);
+}
+
+} // namespace avx512
+#endif // SIMD_X86
+
+// ------------------ DISPATCH ------------------
+
+template <typename T>
+constexpr bool isVectorizable = std::is_same<T, float>::value || std::is_same<T, double>::value;
+
+// out[i] = a[i] + b[i]; out may be a or b
+template <typename T>
+void add(const T* a, const T* b, T* out, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        if (n >= scalarLimit) {
+            switch (activeIsa()) {
+#if SIMD_X86
+            case Isa::AVX512: avx512::add(a, b, out, n); return;
+            case Isa::AVX2: avx2::add(a, b, out, n); return;
+#endif
+            case Isa::Baseline: baseline::add(a, b, out, n); return;
+            default: break;
+            }
+        }
+    }
+    scalar::add(a, b, out, n);
+}
+
+// out[i] = a[i] - b[i]; out may be a or b
+template <typename T>
+void sub(const T* a, const T* b, T* out, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        if (n >= scalarLimit) {
+            switch (activeIsa()) {
+#if SIMD_X86
+            case Isa::AVX512: avx512::sub(a, b, out, n); return;
+            case Isa::AVX2: avx2::sub(a, b, out, n); return;
+#endif
+            case Isa::Baseline: baseline::sub(a, b, out, n); return;
+            default: break;
+            }
+        }
+    }
+    scalar::sub(a, b, out, n);
+}
+
+template <typename T>
+T dot(const T* a, const T* b, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        if (n >= scalarLimit) {
+            switch (activeIsa()) {
+#if SIMD_X86
+            case Isa::AVX512: return avx512::dot(a, b, n);
+            case Isa::AVX2: return avx2::dot(a, b, n);
+#endif
+            case Isa::Baseline: return baseline::dot(a, b, n);
+            default: break;
+            }
+        }
+    }
+    return scalar::dot(a, b, n);
+}
+
+// y[i] += alpha * x[i]
+template <typename T>
+void axpy(T alpha, const T* x, T* y, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        if (n >= scalarLimit) {
+            switch (activeIsa()) {
+#if SIMD_X86
+            case Isa::AVX512: avx512::axpy(alpha, x, y, n); return;
+            case Isa::AVX2: avx2::axpy(alpha, x, y, n); return;
+#endif
+            case Isa::Baseline: baseline::axpy(alpha, x, y, n); return;
+            default: break;
+            }
+        }
+    }
+    scalar::axpy(alpha, x, y, n);
+}
+
+// x[i] *= alpha
+template <typename T>
+void scale(T alpha, T* x, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        if (n >= scalarLimit) {
+            switch (activeIsa()) {
+#if SIMD_X86
+            case Isa::AVX512: avx512::scale(alpha, x, n); return;
+            case Isa::AVX2: avx2::scale(alpha, x, n); return;
+#endif
+            case Isa::Baseline: baseline::scale(alpha, x, n); return;
+            default: break;
+            }
+        }
+    }
+    scalar::scale(alpha, x, n);
+}
+
+// ------------------ ACCUMULATION ------------------
+
+// How products and projections sum their terms:
+//
+//   Native      - in the element type, as everywhere else
+//   Double      - float terms are formed and summed in double lanes and
+//                 rounded to float once at the end; double is unaffected
+//   Compensated - in the element type, with each lane's rounding error
+//                 carried in a second accumulator (Kahan-Babuska-Neumaier,
+//                 with a branch-free TwoSum)
+//
+// Both keep float storage and float memory traffic. The error of a Double
+// sum of n float products is about n * 2^-53 relative to sum |a_i b_i|,
+// far below float's own rounding for any realistic n; a Compensated sum
+// is within about 2 * 2^-24 of it, independent of n, plus the rounding of
+// each product. Double runs at double-precision throughput; Compensated
+// costs about 4 adds per term.
+enum class Accumulation { Native, Double, Compensated };
+
+#ifndef MATRIX_ACCUMULATION
+#define MATRIX_ACCUMULATION Native
+#endif
+
+namespace detail {
+
+inline std::atomic<Accumulation>& currentAccumulation() {
+    static std::atomic<Accumulation> mode(Accumulation::MATRIX_ACCUMULATION);
+    return mode;
+}
+
+} // namespace detail
+
+inline Accumulation activeAccumulation() {
+    return detail::currentAccumulation().load(std::memory_order_relaxed);
+}
+
+inline void setAccumulation(Accumulation mode) {
+    detail::currentAccumulation().store(mode, std::memory_order_relaxed);
+}
+
+// TwoSum is only exact if the compiler doesn't fuse a product into the sum
+// that follows it, which GCC does across statements by default
+#if defined(__GNUC__) && !defined(__clang__)
+#define SIMD_NO_CONTRACT __attribute__((optimize("fp-contract=off")))
+#else
+#define SIMD_NO_CONTRACT
+#endif
+
+namespace accurate {
+
+// sum a[i] * b[i] in double, Bytes of floats at a time. A product of two
+// floats is exact in double, so only the additions round.
+template <size_t Bytes>
+SIMD_INLINE double dotDouble(const float* a, const float* b, size_t n) {
+    double sum = 0;
+    size_t i = 0;
+#if SIMD_VECTOR_EXTENSIONS
+    if constexpr (Bytes > sizeof(float)) {
+        using VF = typename VectorType<float, Bytes>::type;
+        using VD = typename VectorType<double, 2 * Bytes>::type;
+        constexpr size_t W = Bytes / sizeof(float);
+        VD acc0 = {}, acc1 = {};
+        for (; i + 2 * W <= n; i += 2 * W) {
+            VF x0, y0, x1, y1;
+            std::memcpy(&x0, a + i, sizeof(VF));
+            std::memcpy(&y0, b + i, sizeof(VF));
+            std::memcpy(&x1, a + i + W, sizeof(VF));
+            std::memcpy(&y1, b + i + W, sizeof(VF));
+            acc0 += __builtin_convertvector(x0, VD) * __builtin_convertvector(y0, VD);
+            acc1 += __builtin_convertvector(x1, VD) * __builtin_convertvector(y1, VD);
+        }
+        acc0 += acc1;
+        for (size_t w = 0; w < W; w++) {
+            sum += acc0[w];
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        sum += double(a[i]) * double(b[i]);
+    }
+    return sum;
+}
+
+// sum a[i] * b[i] with a compensation term per lane. V is either T itself
+// or a vector of T.
+template <typename V, typename T>
+SIMD_INLINE SIMD_NO_CONTRACT T dotCompensated(const T* a, const T* b, size_t n) {
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    // Two independent chains, so consecutive adds don't wait on each other
+    V sum0 = V(), sum1 = V(), err0 = V(), err1 = V();
+    size_t i = 0;
+    for (; i + 2 * W <= n; i += 2 * W) {
+        V x0, y0, x1, y1;
+        std::memcpy(&x0, a + i, sizeof(V));
+        std::memcpy(&y0, b + i, sizeof(V));
+        std::memcpy(&x1, a + i + W, sizeof(V));
+        std::memcpy(&y1, b + i + W, sizeof(V));
+        V p0 = x0 * y0;
+        V p1 = x1 * y1;
+        V s0 = sum0 + p0;
+        V s1 = sum1 + p1;
+        V z0 = s0 - sum0;
+        V z1 = s1 - sum1;
+        err0 += (sum0 - (s0 - z0)) + (p0 - z0);
+        err1 += (sum1 - (s1 - z1)) + (p1 - z1);
+        sum0 = s0;
+        sum1 = s1;
+    }
+
+    // Then every lane and the leftover terms into one scalar pair
+    T sum = 0, err = 0;
+    T terms[2 * W + 2 * W];
+    std::memcpy(terms, &sum0, sizeof(V));
+    std::memcpy(terms + W, &sum1, sizeof(V));
+    std::memcpy(terms + 2 * W, &err0, sizeof(V));
+    std::memcpy(terms + 3 * W, &err1, sizeof(V));
+    for (size_t w = 0; w < 2 * W; w++) {
+        T s = sum + terms[w];
+        T z = s - sum;
+        err += (sum - (s - z)) + (terms[w] - z);
+        sum = s;
+        err += terms[2 * W + w];
+    }
+    for (; i < n; i++) {
+        T p = a[i] * b[i];
+        T s = sum + p;
+        T z = s - sum;
+        err += (sum - (s - z)) + (p - z);
+        sum = s;
+    }
+    return sum + err;
+}
+
+#if SIMD_X86
+SIMD_TARGET_AVX2 inline double dotDoubleAvx2(const float* a, const float* b, size_t n) {
+    return dotDouble<32>(a, b, n);
+}
+
+SIMD_TARGET_AVX512 inline double dotDoubleAvx512(const float* a, const float* b, size_t n) {
+    return dotDouble<64>(a, b, n);
+}
+
+template <typename T>
+SIMD_TARGET_AVX2 SIMD_NO_CONTRACT T dotCompensatedAvx2(const T* a, const T* b, size_t n) {
+    return dotCompensated<typename VectorType<T, 32>::type>(a, b, n);
+}
+
+template <typename T>
+SIMD_TARGET_AVX512 SIMD_NO_CONTRACT T dotCompensatedAvx512(const T* a, const T* b, size_t n) {
+    return dotCompensated<typename VectorType<T, 64>::type>(a, b, n);
+}
+#endif
+
+} // namespace accurate
+
+// a . b summed in double
+inline double dotDouble(const float* a, const float* b, size_t n) {
+    switch (activeIsa()) {
+#if SIMD_X86
+    case Isa::AVX512: return accurate::dotDoubleAvx512(a, b, n);
+    case Isa::AVX2: return accurate::dotDoubleAvx2(a, b, n);
+#endif
+#if SIMD_VECTOR_EXTENSIONS
+    case Isa::Baseline: return accurate::dotDouble<16>(a, b, n);
+#endif
+    default: return accurate::dotDouble<sizeof(float)>(a, b, n);
+    }
+}
+
+// a . b with compensated summation
+template <typename T>
+T dotCompensated(const T* a, const T* b, size_t n) {
+    if constexpr (isVectorizable<T> && hasBaselineVector<T>) {
+        switch (activeIsa()) {
+#if SIMD_X86
+        case Isa::AVX512: return accurate::dotCompensatedAvx512(a, b, n);
+        case Isa::AVX2: return accurate::dotCompensatedAvx2(a, b, n);
+#endif
+        case Isa::Baseline: return accurate::dotCompensated<typename BaselineVector<T>::type>(a, b, n);
+        default: break;
+        }
+    }
+    return accurate::dotCompensated<T>(a, b, n);
+}
+
+// Whether sums of T are formed in T alone under the active mode: Double
+// leaves double as it is, and neither mode applies to other types
+template <typename T>
+bool nativeAccumulation() {
+    switch (activeAccumulation()) {
+    case Accumulation::Double: return !std::is_same<T, float>::value;
+    case Accumulation::Compensated: return !isVectorizable<T>;
+    case Accumulation::Native: break;
+    }
+    return true;
+}
+
+// a . b under the active accumulation mode, rounded to T
+template <typename T>
+T dotAccumulated(const T* a, const T* b, size_t n) {
+    if constexpr (isVectorizable<T>) {
+        switch (activeAccumulation()) {
+        case Accumulation::Double:
+            if constexpr (std::is_same<T, float>::value) {
+                return T(dotDouble(a, b, n));
+            }
+            break;
+        case Accumulation::Compensated: return dotCompensated(a, b, n);
+        case Accumulation::Native: break;
+        }
+    }
+    return dot(a, b, n);
+}
+
+// ------------------ GEMM MICRO-KERNELS ------------------
+
+// A micro-kernel multiplies an MR-row panel of packed A by an NR-column
+// panel of packed B (see gemm.hpp for the layout) and writes the mr x nr
+// part of the tile that lies inside C, adding to C when accumulate is set.
+
+namespace detail {
+
+template <typename T, size_t MR, size_t NR>
+inline void storeTile(const T (&tile)[MR][NR], T* c, size_t ldc, size_t mr, size_t nr, bool accumulate) {
+    for (size_t i = 0; i < mr; i++) {
+        T* row = c + i * ldc;
+        for (size_t j = 0; j < nr; j++) {
+            row[j] = accumulate ? row[j] + tile[i][j] : tile[i][j];
+        }
+    }
+}
+
+} // namespace detail
+
+template <typename T>
+struct ScalarGemm {
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR = 4;
+
+    static void run(size_t kc, const T* a, const T* b, T* c, size_t ldc,
+                    size_t mr, size_t nr, bool accumulate) {
+        T tile[MR][NR] = {};
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t i = 0; i < MR; i++) {
+                for (size_t j = 0; j < NR; j++) {
+                    tile[i][j] += a[i] * b[j];
+                }
+            }
+            a += MR;
+            b += NR;
+        }
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+
+// Two 16-byte vectors per tile row; a[i] is broadcast across them
+template <typename T, bool = hasBaselineVector<T>>
+struct BaselineGemm : ScalarGemm<T> {};
+
+template <typename T>
+struct BaselineGemm<T, true> {
+    using V = typename BaselineVector<T>::type;
+    static constexpr size_t W = sizeof(V) / sizeof(T);
+    static constexpr size_t MR = 6;
+    static constexpr size_t NR = 2 * W;
+
+    static void run(size_t kc, const T* a, const T* b, T* c, size_t ldc,
+                    size_t mr, size_t nr, bool accumulate) {
+        V acc[MR][2] = {};
+        for (size_t p = 0; p < kc; p++) {
+            V b0, b1;
+            std::memcpy(&b0, b, sizeof(V));
+            std::memcpy(&b1, b + W, sizeof(V));
+            // Fully unrolled so that acc lives in registers even at -O2
+#pragma GCC unroll 8
+            for (size_t i = 0; i < MR; i++) {
+                acc[i][0] += a[i] * b0;
+                acc[i][1] += a[i] * b1;
+            }
+            a += MR;
+            b += NR;
+        }
+        T tile[MR][NR];
+        std::memcpy(tile, acc, sizeof(tile));
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+
+// The wider kernels exist for float and double only; anything else uses
+// the next narrower one
+template <typename T>
+struct Avx2Gemm : BaselineGemm<T> {};
+
+template <typename T>
+struct Avx512Gemm : Avx2Gemm<T> {};
+
+#if SIMD_X86
+template <>
+struct Avx2Gemm<float> {
+    static constexpr size_t MR = 6;
+    static constexpr size_t NR = 16;
+
+    SIMD_TARGET_AVX2 static void run(size_t kc, const float* a, const float* b, float* c, size_t ldc,
+                                     size_t mr, size_t nr, bool accumulate) {
+        __m256 acc[MR][2];
+#pragma GCC unroll 8
+        for (size_t i = 0; i < MR; i++) {
+            acc[i][0] = acc[i][1] = _mm256_setzero_ps();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m256 b0 = _mm256_loadu_ps(b), b1 = _mm256_loadu_ps(b + 8);
+#pragma GCC unroll 8
+            for (size_t i = 0; i < MR; i++) {
+                __m256 ai = _mm256_broadcast_ss(a + i);
+                acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+                acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+            }
+            a += MR;
+            b += NR;
+        }
+        float tile[MR][NR];
+#pragma GCC unroll 8
+        for (size_t i = 0; i < MR; i++) {
+            _mm256_storeu_ps(tile[i], acc[i][0]);
+            _mm256_storeu_ps(tile[i] + 8, acc[i][1]);
+        }
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+
+template <>
+struct Avx2Gemm<double> {
+    static constexpr size_t MR = 6;
+    static constexpr size_t NR = 8;
+
+    SIMD_TARGET_AVX2 static void run(size_t kc, const double* a, const double* b, double* c, size_t ldc,
+                                     size_t mr, size_t nr, bool accumulate) {
+        __m256d acc[MR][2];
+#pragma GCC unroll 8
+        for (size_t i = 0; i < MR; i++) {
+            acc[i][0] = acc[i][1] = _mm256_setzero_pd();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m256d b0 = _mm256_loadu_pd(b), b1 = _mm256_loadu_pd(b + 4);
+#pragma GCC unroll 8
+            for (size_t i = 0; i < MR; i++) {
+                __m256d ai = _mm256_broadcast_sd(a + i);
+                acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+                acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+            }
+            a += MR;
+            b += NR;
+        }
+        double tile[MR][NR];
+#pragma GCC unroll 8
+        for (size_t i = 0; i < MR; i++) {
+            _mm256_storeu_pd(tile[i], acc[i][0]);
+            _mm256_storeu_pd(tile[i] + 4, acc[i][1]);
+        }
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+
+template <>
+struct Avx512Gemm<float> {
+    static constexpr size_t MR = 12;
+    static constexpr size_t NR = 32;
+
+    SIMD_TARGET_AVX512 static void run(size_t kc, const float* a, const float* b, float* c, size_t ldc,
+                                       size_t mr, size_t nr, bool accumulate) {
+        __m512 acc[MR][2];
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; i++) {
+            acc[i][0] = acc[i][1] = _mm512_setzero_ps();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m512 b0 = _mm512_loadu_ps(b), b1 = _mm512_loadu_ps(b + 16);
+#pragma GCC unroll 16
+            for (size_t i = 0; i < MR; i++) {
+                __m512 ai = _mm512_set1_ps(a[i]);
+                acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+                acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+            }
+            a += MR;
+            b += NR;
+        }
+        float tile[MR][NR];
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; i++) {
+            _mm512_storeu_ps(tile[i], acc[i][0]);
+            _mm512_storeu_ps(tile[i] + 16, acc[i][1]);
+        }
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+
+template <>
+struct Avx512Gemm<double> {
+    static constexpr size_t MR = 12;
+    static constexpr size_t NR = 16;
+
+    SIMD_TARGET_AVX512 static void run(size_t kc, const double* a, const double* b, double* c, size_t ldc,
+                                       size_t mr, size_t nr, bool accumulate) {
+        __m512d acc[MR][2];
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; i++) {
+            acc[i][0] = acc[i][1] = _mm512_setzero_pd();
+        }
+        for (size_t p = 0; p < kc; p++) {
+            __m512d b0 = _mm512_loadu_pd(b), b1 = _mm512_loadu_pd(b + 8);
+#pragma GCC unroll 16
+            for (size_t i = 0; i < MR; i++) {
+                __m512d ai = _mm512_set1_pd(a[i]);
+                acc[i][0] = _mm512_fmadd_pd(ai, b0, acc[i][0]);
+                acc[i][1] = _mm512_fmadd_pd(ai, b1, acc[i][1]);
+            }
+            a += MR;
+            b += NR;
+        }
+        double tile[MR][NR];
+#pragma GCC unroll 16
+        for (size_t i = 0; i < MR; i++) {
+            _mm512_storeu_pd(tile[i], acc[i][0]);
+            _mm512_storeu_pd(tile[i] + 8, acc[i][1]);
+        }
+        detail::storeTile(tile, c, ldc, mr, nr, accumulate);
+    }
+};
+#endif // SIMD_X86
+
+// ------------------ TRANSPOSE MICRO-KERNELS ------------------
+
+// A transpose kernel copies one B x B tile, dst[j * ldd + i] = src[i * lds + j],
+// holding the whole tile in registers. See transpose.hpp for the blocking
+// around it.
+
+template <typename T>
+struct ScalarTranspose {
+    static constexpr size_t B = 4;
+
+    static void run(const T* src, size_t lds, T* dst, size_t ldd) {
+        for (size_t i = 0; i < B; i++) {
+            for (size_t j = 0; j < B; j++) {
+                dst[j * ldd + i] = src[i * lds + j];
+            }
+        }
+    }
+};
+
+template <typename T>
+struct BaselineTranspose : ScalarTranspose<T> {};
+
+// The AVX-512 path reuses the AVX2 tiles: the transpose is bound by memory,
+// not by shuffles, and 8x8 floats already fill whole cache lines
+template <typename T>
+struct Avx2Transpose : BaselineTranspose<T> {};
+
+template <typename T>
+struct Avx512Transpose : Avx2Transpose<T> {};
+
+#if SIMD_X86 && defined(__SSE2__)
+template <>
+struct BaselineTranspose<float> {
+    static constexpr size_t B = 4;
+
+    static void run(const float* src, size_t lds, float* dst, size_t ldd) {
+        __m128 r0 = _mm_loadu_ps(src), r1 = _mm_loadu_ps(src + lds);
+        __m128 r2 = _mm_loadu_ps(src + 2 * lds), r3 = _mm_loadu_ps(src + 3 * lds);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst, r0);
+        _mm_storeu_ps(dst + ldd, r1);
+        _mm_storeu_ps(dst + 2 * ldd, r2);
+        _mm_storeu_ps(dst + 3 * ldd, r3);
+    }
+};
+
+template <>
+struct BaselineTranspose<double> {
+    static constexpr size_t B = 2;
+
+    static void run(const double* src, size_t lds, double* dst, size_t ldd) {
+        __m128d r0 = _mm_loadu_pd(src), r1 = _mm_loadu_pd(src + lds);
+        _mm_storeu_pd(dst, _mm_unpacklo_pd(r0, r1));
+        _mm_storeu_pd(dst + ldd, _mm_unpackhi_pd(r0, r1));
+    }
+};
+#endif
+
+#if SIMD_X86
+template <>
+struct Avx2Transpose<float> {
+    static constexpr size_t B = 8;
+
+    SIMD_TARGET_AVX2 static void run(const float* src, size_t lds, float* dst, size_t ldd) {
+        __m256 r[8], t[8];
+#pragma GCC unroll 8
+        for (size_t i = 0; i < 8; i++) {
+            r[i] = _mm256_loadu_ps(src + i * lds);
+        }
+        // Interleave pairs of rows, then pairs of pairs, then swap 128-bit halves
+#pragma GCC unroll 4
+        for (size_t i = 0; i < 8; i += 2) {
+            t[i] = _mm256_unpacklo_ps(r[i], r[i + 1]);
+            t[i + 1] = _mm256_unpackhi_ps(r[i], r[i + 1]);
+        }
+#pragma GCC unroll 2
+        for (size_t i = 0; i < 8; i += 4) {
+            r[i] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+            r[i + 1] = _mm256_shuffle_ps(t[i], t[i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+            r[i + 2] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+            r[i + 3] = _mm256_shuffle_ps(t[i + 1], t[i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+        }
+#pragma GCC unroll 4
+        for (size_t i = 0; i < 4; i++) {
+            _mm256_storeu_ps(dst + i * ldd, _mm256_permute2f128_ps(r[i], r[i + 4], 0x20));
+            _mm256_storeu_ps(dst + (i + 4) * ldd, _mm256_permute2f128_ps(r[i], r[i + 4], 0x31));
+        }
+    }
+};
+
+template <>
+struct Avx2Transpose<double> {
+    static constexpr size_t B = 4;
+
+    SIMD_TARGET_AVX2 static void run(const double* src, size_t lds, double* dst, size_t ldd) {
+        __m256d r0 = _mm256_loadu_pd(src), r1 = _mm256_loadu_pd(src + lds);
+        __m256d r2 = _mm256_loadu_pd(src + 2 * lds), r3 = _mm256_loadu_pd(src + 3 * lds);
+        __m256d t0 = _mm256_unpacklo_pd(r0, r1), t1 = _mm256_unpackhi_pd(r0, r1);
+        __m256d t2 = _mm256_unpacklo_pd(r2, r3), t3 = _mm256_unpackhi_pd(r2, r3);
+        _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+};
+#endif // SIMD_X86
+
+} // namespace simd
+
+#endif // SIMD_HPP
@@ -0,0 +1,463 @@
+#ifndef SPARSE_HPP
+#define SPARSE_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.hpp"
+#include "blas.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// A matrix that stores only its nonzero elements, compressed by row (CSR)
+// or by column (CSC). For the Row layout, row i's elements are
+// values()[offsets[i] .. offsets[i + 1]) in increasing column order,
+// innerIndices() holding their columns; the Column layout is the same
+// with rows and columns swapped. Memory is O(nnz + outer dimension) and
+// every operation below costs O(nnz) times the width of the dense operand,
+// never rows x cols.
+//
+//     std::vector<Triplet<double>> entries = {{0, 0, 1.0}, {4, 2, -2.0}};
+//     SparseMatrix<double> a(5, 3, entries);
+//     Matrix<double> y = a * x;           // SpMV, or SpMM for a wider x
+//     blas::gemv(1.0, a, x, 1.0, y);      // y += A x, without allocating
+//     auto moved = transform(RotateMatrix<double>(30), points);
+//
+// CSR suits products with a dense right operand; CSC suits building a
+// matrix column by column and transform(), and is what transpose() of a
+// CSR matrix gives for free. Explicit zeros are never stored.
+enum class SparseLayout { Row, Column };
+
+// One element of a sparse matrix, for building it
+template <typename T>
+struct Triplet {
+    size_t row, col;
+    T value;
+};
+
+template <typename T, SparseLayout L = SparseLayout::Row>
+class SparseMatrix {
+    template <typename U, SparseLayout O> friend class SparseMatrix;
+
+public:
+    using value_type = T;
+    static constexpr SparseLayout layout = L;
+    static constexpr SparseLayout otherLayout = L == SparseLayout::Row ? SparseLayout::Column : SparseLayout::Row;
+
+    // An empty 0 x 0 matrix
+    explicit SparseMatrix(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : SparseMatrix(0, 0, resource) {}
+
+    // An all-zero rows x cols matrix
+    SparseMatrix(size_t rows, size_t cols, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // From (row, col, value) triplets in any order. Duplicates are summed
+    // and elements that come to zero are dropped.
+    SparseMatrix(size_t rows, size_t cols, const std::vector<Triplet<T>>& triplets,
+                 std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // The nonzero elements of a dense matrix, including the transform classes
+    explicit SparseMatrix(const Matrix<T>& dense,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    template <size_t R, size_t C>
+    explicit SparseMatrix(const Matrix<T, R, C>& dense,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    // The same matrix in the other layout, in O(nnz + rows + cols)
+    explicit SparseMatrix(const SparseMatrix<T, otherLayout>& other,
+                          std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    Matrix<T> toDense(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const;
+
+    size_t getRows() const { return rows; }
+    size_t getCols() const { return cols; }
+    size_t nonZeros() const { return vals.size(); }
+
+    // Element (i, j), found by binary search in its row or column
+    T getElement(size_t i, size_t j) const;
+
+    // The transpose in the other layout: the arrays are copied as they are
+    SparseMatrix<T, otherLayout> transpose() const;
+
+    // The compressed arrays. The outer dimension is rows for the Row
+    // layout and columns for the Column layout.
+    size_t outerSize() const { return offsets.size() - 1; }
+    const size_t* outerOffsets() const { return offsets.data(); }
+    const size_t* innerIndices() const { return inner.data(); }
+    const T* values() const { return vals.data(); }
+    T* values() { return vals.data(); }
+
+private:
+    size_t rows, cols;
+    std::pmr::vector<size_t> offsets; // outerSize() + 1 entries
+    std::pmr::vector<size_t> inner;   // nonZeros() entries
+    std::pmr::vector<T> vals;         // nonZeros() entries
+
+    // at(i, j) reads element (i, j) of a rows x cols dense matrix
+    template <typename At>
+    void fromDense(At at);
+};
+
+// y = A * x for a dense x of any width: SpMV for a column vector, SpMM
+// otherwise. x may be a matrix, a view or any matrix expression.
+template <typename T, SparseLayout L, typename E>
+Matrix<T> operator*(const SparseMatrix<T, L>& a, const MatrixExpr<E>& x);
+
+// Applies a transform (or any dense p x d matrix) to the d-dimensional
+// vectors that are the columns of a sparse d x N matrix, keeping the
+// result sparse: O(p * nnz) work and storage, where a dense product would
+// be O(p * N)
+template <typename T, SparseLayout L>
+SparseMatrix<T, L> transform(const Matrix<T>& m, const SparseMatrix<T, L>& vectors);
+
+template <typename T, size_t R, size_t C, SparseLayout L>
+SparseMatrix<T, L> transform(const Matrix<T, R, C>& m, const SparseMatrix<T, L>& vectors);
+
+// ------------------ KERNELS ------------------
+
+namespace detail {
+
+// Runs body(begin, end) over bands of outer indices holding about the same
+// number of nonzeros each, across the thread pool when the work is large
+template <typename F>
+void forNonZeroBands(const size_t* offsets, size_t outer, size_t work, F&& body) {
+    if (outer == 0 || !parallel::worthSplitting(work, parallel::elementwiseThreshold)) {
+        body(0, outer);
+        return;
+    }
+    size_t bands = std::min(outer, 4 * parallel::threadCount());
+    size_t total = offsets[outer];
+    // The band boundaries, where the running nonzero count crosses each share
+    std::vector<size_t> bounds(bands + 1, outer);
+    bounds[0] = 0;
+    for (size_t b = 1; b < bands; b++) {
+        size_t target = total / bands * b;
+        bounds[b] = std::max(bounds[b - 1], size_t(std::lower_bound(offsets, offsets + outer, target) - offsets));
+    }
+    parallel::parallelFor(bands, [&](size_t band) {
+        if (bounds[band] < bounds[band + 1]) {
+            body(bounds[band], bounds[band + 1]);
+        }
+    });
+}
+
+// y = alpha * A * x + beta * y; y overlaps neither A nor x
+template <typename T, SparseLayout L>
+void sparseMultiply(T alpha, const SparseMatrix<T, L>& a, const MatrixView<const T>& x, T beta,
+                    const MatrixView<T>& y) {
+    const size_t* offsets = a.outerOffsets();
+    const size_t* inner = a.innerIndices();
+    const T* vals = a.values();
+    size_t n = x.getCols();
+    bool rowsContiguous = x.getColStride() == 1 && y.getColStride() == 1;
+
+    // y.row(i) += v * x.row(k)
+    auto update = [&](size_t i, size_t k, T v) {
+        if (rowsContiguous) {
+            simd::axpy(v, &x(k, 0), &y(i, 0), n);
+        } else {
+            for (size_t j = 0; j < n; j++) {
+                y(i, j) += v * x(k, j);
+            }
+        }
+    };
+    auto scaleRows = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (size_t j = 0; j < n; j++) {
+                y(i, j) = beta == T(0) ? T(0) : beta * y(i, j);
+            }
+        }
+    };
+
+    size_t work = a.nonZeros() * std::max<size_t>(n, 1);
+    if constexpr (L == SparseLayout::Row) {
+        // Each row of y is a combination of rows of x
+        forNonZeroBands(offsets, a.getRows(), work, [&](size_t begin, size_t end) {
+            scaleRows(begin, end);
+            for (size_t i = begin; i < end; i++) {
+                if (n == 1) {
+                    T sum = 0;
+                    for (size_t p = offsets[i]; p < offsets[i + 1]; p++) {
+                        sum += vals[p] * x(inner[p], 0);
+                    }
+                    y(i, 0) += alpha * sum;
+                } else {
+                    for (size_t p = offsets[i]; p < offsets[i + 1]; p++) {
+                        update(i, inner[p], alpha * vals[p]);
+                    }
+                }
+            }
+        });
+    } else {
+        // Columns of A scatter into y. Each band owns a range of rows of y
+        // and finds its part of every column by binary search.
+        forRowBands(a.getRows(), work, [&](size_t begin, size_t end) {
+            scaleRows(begin, end);
+            for (size_t k = 0; k < a.getCols(); k++) {
+                const size_t* first = inner + offsets[k];
+                const size_t* last = inner + offsets[k + 1];
+                if (begin > 0) {
+                    first = std::lower_bound(first, last, begin);
+                }
+                for (const size_t* p = first; p != last && *p < end; p++) {
+                    update(*p, k, alpha * vals[p - inner]);
+                }
+            }
+        });
+    }
+}
+
+// m * vectors for a column-compressed d x N matrix of vectors and a p x d
+// m read through at(i, r)
+template <typename T, typename At>
+SparseMatrix<T, SparseLayout::Column> transformColumns(size_t p, size_t d, At at,
+                                                       const SparseMatrix<T, SparseLayout::Column>& vectors) {
+    if (d != vectors.getRows()) {
+        throw runtime_error("Error: Matrix sizes do not match for multiplication!");
+    }
+    const size_t* offsets = vectors.outerOffsets();
+    const size_t* inner = vectors.innerIndices();
+    const T* vals = vectors.values();
+    std::vector<Triplet<T>> entries;
+    entries.reserve(std::min(vectors.nonZeros() * p, p * vectors.getCols()));
+    for (size_t col = 0; col < vectors.getCols(); col++) {
+        if (offsets[col] == offsets[col + 1]) {
+            continue;
+        }
+        for (size_t i = 0; i < p; i++) {
+            T sum = 0;
+            for (size_t q = offsets[col]; q < offsets[col + 1]; q++) {
+                sum += at(i, inner[q]) * vals[q];
+            }
+            if (sum != T(0)) {
+                entries.push_back({i, col, sum});
+            }
+        }
+    }
+    return SparseMatrix<T, SparseLayout::Column>(p, vectors.getCols(), entries);
+}
+
+template <typename T, SparseLayout L, typename At>
+SparseMatrix<T, L> transformSparse(size_t p, size_t d, At at, const SparseMatrix<T, L>& vectors) {
+    if constexpr (L == SparseLayout::Column) {
+        return transformColumns<T>(p, d, at, vectors);
+    } else {
+        SparseMatrix<T, SparseLayout::Column> columns(vectors);
+        return SparseMatrix<T, L>(transformColumns<T>(p, d, at, columns));
+    }
+}
+
+} // namespace detail
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, L>::SparseMatrix(size_t rows, size_t cols, std::pmr::memory_resource* resource)
+: rows(rows), cols(cols), offsets((L == SparseLayout::Row ? rows : cols) + 1, 0, resource),
+  inner(resource), vals(resource) {}
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, L>::SparseMatrix(size_t rows, size_t cols, const std::vector<Triplet<T>>& triplets,
+                                 std::pmr::memory_resource* resource)
+: SparseMatrix(rows, cols, resource) {
+    auto outerOf = [](const Triplet<T>& t) { return L == SparseLayout::Row ? t.row : t.col; };
+    auto innerOf = [](const Triplet<T>& t) { return L == SparseLayout::Row ? t.col : t.row; };
+
+    // Counting sort into rows (or columns)
+    for (const Triplet<T>& t : triplets) {
+        if (t.row >= rows || t.col >= cols) {
+            throw std::out_of_range("Matrix index out of range");
+        }
+        offsets[outerOf(t) + 1]++;
+    }
+    for (size_t o = 0; o < outerSize(); o++) {
+        offsets[o + 1] += offsets[o];
+    }
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    std::vector<std::pair<size_t, T>> sorted(triplets.size());
+    for (const Triplet<T>& t : triplets) {
+        sorted[next[outerOf(t)]++] = {innerOf(t), t.value};
+    }
+
+    // Then sort within each, summing duplicates and dropping zeros
+    inner.reserve(triplets.size());
+    vals.reserve(triplets.size());
+    size_t begin = 0;
+    for (size_t o = 0; o < outerSize(); o++) {
+        size_t end = offsets[o + 1];
+        std::sort(sorted.begin() + begin, sorted.begin() + end,
+                  [](const auto& x, const auto& y) { return x.first < y.first; });
+        for (size_t p = begin; p < end;) {
+            size_t index = sorted[p].first;
+            T sum = 0;
+            for (; p < end && sorted[p].first == index; p++) {
+                sum += sorted[p].second;
+            }
+            if (sum != T(0)) {
+                inner.push_back(index);
+                vals.push_back(sum);
+            }
+        }
+        offsets[o + 1] = vals.size();
+        begin = end;
+    }
+}
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, L>::SparseMatrix(const Matrix<T>& dense, std::pmr::memory_resource* resource)
+: SparseMatrix(dense.getRows(), dense.getCols(), resource) {
+    fromDense([&](size_t i, size_t j) { return dense(i, j); });
+}
+
+template <typename T, SparseLayout L>
+template <size_t R, size_t C>
+SparseMatrix<T, L>::SparseMatrix(const Matrix<T, R, C>& dense, std::pmr::memory_resource* resource)
+: SparseMatrix(R, C, resource) {
+    fromDense([&](size_t i, size_t j) { return dense(i, j); });
+}
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, L>::SparseMatrix(const SparseMatrix<T, otherLayout>& other, std::pmr::memory_resource* resource)
+: SparseMatrix(other.rows, other.cols, resource) {
+    // Our outer index is other's inner one: count, then scatter. Walking
+    // other in order leaves each of our rows (or columns) sorted.
+    size_t nnz = other.nonZeros();
+    inner.resize(nnz);
+    vals.resize(nnz);
+    for (size_t p = 0; p < nnz; p++) {
+        offsets[other.inner[p] + 1]++;
+    }
+    for (size_t o = 0; o < outerSize(); o++) {
+        offsets[o + 1] += offsets[o];
+    }
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t o = 0; o < other.outerSize(); o++) {
+        for (size_t p = other.offsets[o]; p < other.offsets[o + 1]; p++) {
+            size_t q = next[other.inner[p]]++;
+            inner[q] = o;
+            vals[q] = other.vals[p];
+        }
+    }
+}
+
+template <typename T, SparseLayout L>
+template <typename At>
+void SparseMatrix<T, L>::fromDense(At at) {
+    size_t outer = outerSize(), innerSize = L == SparseLayout::Row ? cols : rows;
+    for (size_t o = 0; o < outer; o++) {
+        for (size_t k = 0; k < innerSize; k++) {
+            T value = L == SparseLayout::Row ? at(o, k) : at(k, o);
+            if (value != T(0)) {
+                inner.push_back(k);
+                vals.push_back(value);
+            }
+        }
+        offsets[o + 1] = vals.size();
+    }
+}
+
+template <typename T, SparseLayout L>
+Matrix<T> SparseMatrix<T, L>::toDense(std::pmr::memory_resource* resource) const {
+    Matrix<T> dense(rows, cols, resource);
+    for (size_t o = 0; o < outerSize(); o++) {
+        for (size_t p = offsets[o]; p < offsets[o + 1]; p++) {
+            if (L == SparseLayout::Row) {
+                dense(o, inner[p]) = vals[p];
+            } else {
+                dense(inner[p], o) = vals[p];
+            }
+        }
+    }
+    return dense;
+}
+
+template <typename T, SparseLayout L>
+T SparseMatrix<T, L>::getElement(size_t i, size_t j) const {
+    if (i >= rows || j >= cols) {
+        throw std::out_of_range("Matrix index out of range");
+    }
+    size_t o = L == SparseLayout::Row ? i : j;
+    size_t k = L == SparseLayout::Row ? j : i;
+    const size_t* first = inner.data() + offsets[o];
+    const size_t* last = inner.data() + offsets[o + 1];
+    const size_t* found = std::lower_bound(first, last, k);
+    return found != last && *found == k ? vals[found - inner.data()] : T(0);
+}
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, SparseMatrix<T, L>::otherLayout> SparseMatrix<T, L>::transpose() const {
+    SparseMatrix<T, otherLayout> result(cols, rows);
+    result.offsets.assign(offsets.begin(), offsets.end());
+    result.inner.assign(inner.begin(), inner.end());
+    result.vals.assign(vals.begin(), vals.end());
+    return result;
+}
+
+template <typename T, SparseLayout L, typename E>
+Matrix<T> operator*(const SparseMatrix<T, L>& a, const MatrixExpr<E>& x) {
+    // Matrices and views are read in place
+    const auto& operand = [&]() -> decltype(auto) {
+        if constexpr (IsStridedLeaf<E>::value) {
+            return detail::constView(x.self());
+        } else {
+            return evaluated(x);
+        }
+    }();
+    if (a.getCols() != operand.getRows()) {
+        throw runtime_error("Error: Matrix sizes do not match for multiplication!");
+    }
+    Matrix<T> result(a.getRows(), operand.getCols());
+    detail::sparseMultiply(T(1), a, detail::constView(operand), T(0), detail::writableView(result));
+    return result;
+}
+
+template <typename T, SparseLayout L>
+SparseMatrix<T, L> transform(const Matrix<T>& m, const SparseMatrix<T, L>& vectors) {
+    return detail::transformSparse(m.getRows(), m.getCols(), [&](size_t i, size_t j) { return m(i, j); }, vectors);
+}
+
+template <typename T, size_t R, size_t C, SparseLayout L>
+SparseMatrix<T, L> transform(const Matrix<T, R, C>& m, const SparseMatrix<T, L>& vectors) {
+    return detail::transformSparse(R, C, [&](size_t i, size_t j) { return m(i, j); }, vectors);
+}
+
+// ------------------ BLAS ------------------
+
+// The fused forms of blas.hpp with a sparse A, writing into a destination
+// the caller owns
+namespace blas {
+
+// C = alpha * A * B + beta * C
+template <typename T, SparseLayout L, typename B, typename C>
+void gemm(Scalar<C> alpha, const SparseMatrix<T, L>& a, const B& b, Scalar<C> beta, C&& c) {
+    auto right = ::detail::constView(b);
+    auto dst = ::detail::writableView(c);
+    if (a.getCols() != right.getRows() || a.getRows() != dst.getRows() || right.getCols() != dst.getCols()) {
+        throw runtime_error("Error: Matrix sizes do not match for gemm!");
+    }
+    // C is written while B is still being read
+    if (::detail::overlaps(right, dst)) {
+        Matrix<T> result(dst);
+        ::detail::sparseMultiply(alpha, a, right, beta, ::detail::writableView(result));
+        ::detail::copyElements(::detail::constView(result), dst);
+        return;
+    }
+    ::detail::sparseMultiply(alpha, a, right, beta, dst);
+}
+
+// y = alpha * A * x + beta * y, for column vectors x and y
+template <typename T, SparseLayout L, typename X, typename Y>
+void gemv(Scalar<Y> alpha, const SparseMatrix<T, L>& a, const X& x, Scalar<Y> beta, Y&& y) {
+    auto vec = ::detail::constView(x);
+    if (vec.getCols() != 1) {
+        throw runtime_error("Error: Matrix sizes do not match for gemv!");
+    }
+    gemm(alpha, a, x, beta, y);
+}
+
+} // namespace blas
+
+#endif // SPARSE_HPP
@@ -0,0 +1,206 @@
+#ifndef STRASSEN_HPP
+#define STRASSEN_HPP
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "gemm.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Strassen-Winograd multiplication for large products: each level splits
+// A, B and C into quadrants and forms C from 7 half-size products and 15
+// quadrant additions instead of 8 products, so n x n costs O(n^2.81)
+// instead of O(n^3). The recursion stops once any dimension drops below
+// threshold() and hands the quadrants to the blocked kernel in gemm.hpp.
+//
+// The quadrant sums and two of the products go through two temporaries
+// per level, in the schedule of Boyer, Dumas, Pernet and Zhou, "Memory
+// efficient scheduling of Strassen-Winograd's matrix multiplication
+// algorithm" (2009); everything else is written straight into the
+// quadrants of C. The temporaries of every level are carved out of one
+// buffer, allocated once per product.
+//
+// Odd dimensions are peeled: the even part goes through the recursion and
+// the last row, column and shared index are added with the blocked kernel.
+//
+// Crossover, measured single-threaded on an AVX-512 x86-64 machine
+// against the blocked kernel (min of 3 runs, float and double alike):
+// within noise up to 1536, 8-13% faster at 2048, about 11% at 3072 and
+// 15-25% at 4096. Leaves under about 512 lose more to the extra passes
+// over memory than the saved products give back, so the default
+// threshold of 1024 keeps every leaf at 512 or more.
+//
+// Accuracy: the result is normwise, not componentwise, accurate. With
+// the recursion stopping at classical products of size n0 the error
+// bound is
+//
+//     |C - C'| <= ((n / n0)^log2(18) (n0^2 + 6 n0) - 6 n) u |A| |B|
+//
+// (Higham, "Accuracy and Stability of Numerical Algorithms", 2nd ed.,
+// section 23.2.2), against n^2 u |A| |B| for the classical product: the
+// bound grows by up to 18x per level where classical grows by 4x. The
+// observed growth is far smaller, about 2.3x per level on random
+// matrices (3 levels at n = 256: 2.9e-13 against 2.4e-14 for double).
+// Small elements of C next to large ones can still lose all of their
+// relative accuracy, which is why the threshold can be raised, or the
+// path disabled with setThreshold(0), per program.
+namespace strassen {
+
+#ifndef MATRIX_STRASSEN_THRESHOLD
+#define MATRIX_STRASSEN_THRESHOLD 1024
+#endif
+
+namespace detail {
+
+inline std::atomic<size_t>& thresholdStorage() {
+    static std::atomic<size_t> threshold(MATRIX_STRASSEN_THRESHOLD);
+    return threshold;
+}
+
+} // namespace detail
+
+// Products whose three dimensions are all at least this large use the
+// recursion. 0 disables it, as does any simd::Accumulation but Native:
+// the quadrant sums round in the element type whatever the leaves do.
+inline size_t threshold() {
+    return detail::thresholdStorage().load(std::memory_order_relaxed);
+}
+
+inline void setThreshold(size_t size) {
+    detail::thresholdStorage().store(size, std::memory_order_relaxed);
+}
+
+inline bool applies(size_t m, size_t n, size_t k) {
+    size_t limit = threshold();
+    return limit > 0 && m >= limit && n >= limit && k >= limit &&
+           simd::activeAccumulation() == simd::Accumulation::Native;
+}
+
+// Runs row(i) for each of m rows of n elements, in bands across the pool
+// when the block is large
+template <typename Row>
+void forRows(size_t m, size_t n, Row row) {
+    if (parallel::worthSplitting(m * n, parallel::elementwiseThreshold)) {
+        size_t bands = std::min(m, 4 * parallel::threadCount());
+        parallel::parallelFor(bands, [&](size_t band) {
+            for (size_t i = band * m / bands; i < (band + 1) * m / bands; i++) {
+                row(i);
+            }
+        });
+    } else {
+        for (size_t i = 0; i < m; i++) {
+            row(i);
+        }
+    }
+}
+
+// c = a + b and c = a - b on m x n blocks with their own row strides; c
+// may be a or b
+template <typename T>
+void add(size_t m, size_t n, const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc) {
+    forRows(m, n, [&](size_t i) { simd::add(a + i * lda, b + i * ldb, c + i * ldc, n); });
+}
+
+template <typename T>
+void sub(size_t m, size_t n, const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc) {
+    forRows(m, n, [&](size_t i) { simd::sub(a + i * lda, b + i * ldb, c + i * ldc, n); });
+}
+
+// Elements of workspace one product of this shape needs, summed over
+// every level of the recursion
+inline size_t workspaceSize(size_t m, size_t n, size_t k) {
+    size_t total = 0;
+    while (applies(m, n, k)) {
+        m /= 2;
+        n /= 2;
+        k /= 2;
+        total += m * std::max(k, n) + k * n;
+    }
+    return total;
+}
+
+template <typename T>
+void recurse(size_t m, size_t n, size_t k, const T* a, size_t lda, const T* b, size_t ldb,
+             T* c, size_t ldc, T* work);
+
+// C = A * B for the even part, through 7 half-size products
+template <typename T>
+void winograd(size_t m, size_t n, size_t k, const T* a, size_t lda, const T* b, size_t ldb,
+              T* c, size_t ldc, T* work) {
+    size_t mh = m / 2, nh = n / 2, kh = k / 2;
+    const T *a11 = a, *a12 = a + kh, *a21 = a + mh * lda, *a22 = a21 + kh;
+    const T *b11 = b, *b12 = b + nh, *b21 = b + kh * ldb, *b22 = b21 + nh;
+    T *c11 = c, *c12 = c + nh, *c21 = c + mh * ldc, *c22 = c21 + nh;
+
+    // X holds the A-side sums and then P1; Y holds the B-side sums
+    size_t ldx = std::max(kh, nh), ldy = nh;
+    T* x = work;
+    T* y = x + mh * ldx;
+    T* next = y + kh * ldy;
+
+    sub(mh, kh, a11, lda, a21, lda, x, ldx);                  // S3 = A11 - A21
+    sub(kh, nh, b22, ldb, b12, ldb, y, ldy);                  // T3 = B22 - B12
+    recurse(mh, nh, kh, x, ldx, y, ldy, c21, ldc, next);      // P7 = S3 T3
+    add(mh, kh, a21, lda, a22, lda, x, ldx);                  // S1 = A21 + A22
+    sub(kh, nh, b12, ldb, b11, ldb, y, ldy);                  // T1 = B12 - B11
+    recurse(mh, nh, kh, x, ldx, y, ldy, c22, ldc, next);      // P5 = S1 T1
+    sub(mh, kh, x, ldx, a11, lda, x, ldx);                    // S2 = S1 - A11
+    sub(kh, nh, b22, ldb, y, ldy, y, ldy);                    // T2 = B22 - T1
+    recurse(mh, nh, kh, x, ldx, y, ldy, c12, ldc, next);      // P6 = S2 T2
+    sub(mh, kh, a12, lda, x, ldx, x, ldx);                    // S4 = A12 - S2
+    recurse(mh, nh, kh, x, ldx, b22, ldb, c11, ldc, next);    // P3 = S4 B22
+    recurse(mh, nh, kh, a11, lda, b11, ldb, x, ldx, next);    // P1 = A11 B11
+    add(mh, nh, x, ldx, c12, ldc, c12, ldc);                  // U2 = P1 + P6
+    add(mh, nh, c12, ldc, c21, ldc, c21, ldc);                // U3 = U2 + P7
+    add(mh, nh, c12, ldc, c22, ldc, c12, ldc);                // U4 = U2 + P5
+    add(mh, nh, c21, ldc, c22, ldc, c22, ldc);                // U7 = U3 + P5  -> C22
+    add(mh, nh, c12, ldc, c11, ldc, c12, ldc);                // U5 = U4 + P3  -> C12
+    sub(kh, nh, y, ldy, b21, ldb, y, ldy);                    // T4 = T2 - B21
+    recurse(mh, nh, kh, a22, lda, y, ldy, c11, ldc, next);    // P4 = A22 T4
+    sub(mh, nh, c21, ldc, c11, ldc, c21, ldc);                // U6 = U3 - P4  -> C21
+    recurse(mh, nh, kh, a12, lda, b21, ldb, c11, ldc, next);  // P2 = A12 B21
+    add(mh, nh, x, ldx, c11, ldc, c11, ldc);                  // U1 = P1 + P2  -> C11
+}
+
+template <typename T>
+void recurse(size_t m, size_t n, size_t k, const T* a, size_t lda, const T* b, size_t ldb,
+             T* c, size_t ldc, T* work) {
+    if (!applies(m, n, k)) {
+        gemm::multiply(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+    size_t me = m / 2 * 2, ne = n / 2 * 2, ke = k / 2 * 2;
+    winograd(me, ne, ke, a, lda, b, ldb, c, ldc, work);
+
+    // Whatever the even part left out
+    if (ke < k) {
+        gemm::multiplyAdd(me, ne, size_t(1), T(1), a + ke, lda, size_t(1), b + ke * ldb, ldb, size_t(1),
+                          T(1), c, ldc);
+    }
+    if (ne < n) {
+        gemm::multiply(me, size_t(1), k, a, lda, b + ne, ldb, c + ne, ldc);
+    }
+    if (me < m) {
+        gemm::multiply(size_t(1), n, k, a + me * lda, lda, b, ldb, c + me * ldc, ldc);
+    }
+}
+
+// C = A * B for row-major A and B: the recursion when the product is
+// large enough, the blocked kernel otherwise. C must not overlap A or B.
+template <typename T>
+void multiply(size_t m, size_t n, size_t k,
+              const T* a, size_t lda, const T* b, size_t ldb, T* c, size_t ldc) {
+    if (!applies(m, n, k)) {
+        gemm::multiply(m, n, k, a, lda, b, ldb, c, ldc);
+        return;
+    }
+    std::vector<T> work(workspaceSize(m, n, k));
+    recurse(m, n, k, a, lda, b, ldb, c, ldc, work.data());
+}
+
+} // namespace strassen
+
+#endif // STRASSEN_HPP
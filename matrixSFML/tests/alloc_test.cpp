@@ -0,0 +1,107 @@
+// Checks that chained products reuse the buffers of their temporaries:
+// result = rotMat * reflectMat * vecMat, as in the reflect handler of
+// main.cpp, and m *= b each allocate at most once, and agree with the
+// same products computed out of place. Counts come from the counting
+// operator new of bench/counting_allocator.cpp.
+//
+// Built twice, like sbo_bench: alloc_test with the default inline storage
+// and alloc_test_heap with MATRIX_INLINE_CAPACITY=0, where every matrix
+// is on the heap and the counts matter.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "../matrix.hpp"
+#include "../bench/counting_allocator.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, size_t m, size_t n) {
+    if (!ok) {
+        std::printf("FAILED: %s (%zu x %zu)\n", what, m, n);
+        failures++;
+    }
+}
+
+static Matrix<float> randomMatrix(size_t m, size_t n, std::mt19937& gen) {
+    std::uniform_real_distribution<float> dist(-1, 1);
+    Matrix<float> a(m, n);
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = 0; j < n; j++) {
+            a(i, j) = dist(gen);
+        }
+    }
+    return a;
+}
+
+static bool near(const Matrix<float>& a, const Matrix<float>& b) {
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.getRows(); i++) {
+        for (size_t j = 0; j < a.getCols(); j++) {
+            float scale = std::max(1.0f, std::abs(b(i, j)));
+            if (std::abs(a(i, j) - b(i, j)) > 1e-4f * scale) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The reflect handler of main.cpp, on runtime-sized matrices
+static void reflectChain() {
+    RotateMatrix<float> rotMat(90);
+    ReflectMatrix<float> reflectMat(2, 2, true, false);
+    Matrix<float> vecMat(2, 1);
+    vecMat(0, 0) = 3;
+    vecMat(1, 0) = -2;
+    Matrix<float> result(2, 1);
+
+    Matrix<float> rotReflect = rotMat * reflectMat;
+    Matrix<float> expected = rotReflect * vecMat;
+
+    size_t before = counting::allocations();
+    result = rotMat * reflectMat * vecMat;
+    size_t made = counting::allocations() - before;
+    check(made <= 1, "rotMat * reflectMat * vecMat allocates at most once", 2, 2);
+    check(near(result, expected), "rotMat * reflectMat * vecMat matches the out-of-place product", 2, 2);
+}
+
+// Two k x k transforms applied to k x c vectors, and m *= b for an n x k
+// matrix m. The result of each fits the buffer of the product before it,
+// and up to 16 x 16 (the in-place limit of Matrix<T>) it is computed there.
+static void chains(size_t n, size_t k, size_t c, std::mt19937& gen) {
+    Matrix<float> t1 = randomMatrix(k, k, gen);
+    Matrix<float> t2 = randomMatrix(k, k, gen);
+    Matrix<float> v = randomMatrix(k, c, gen);
+    Matrix<float> t12 = t1 * t2;
+    Matrix<float> expected = t12 * v;
+    Matrix<float> result(k, c);
+
+    size_t before = counting::allocations();
+    result = t1 * t2 * v;
+    check(counting::allocations() - before <= 1, "t1 * t2 * v allocates at most once", k, c);
+    check(near(result, expected), "t1 * t2 * v matches the out-of-place product", k, c);
+
+    Matrix<float> m = randomMatrix(n, k, gen);
+    Matrix<float> product = m * t1;
+    before = counting::allocations();
+    m *= t1;
+    check(counting::allocations() - before <= 1, "m *= b allocates at most once", n, k);
+    check(near(m, product), "m *= b matches the out-of-place product", n, k);
+}
+
+int main() {
+    reflectChain();
+    std::mt19937 gen(7);
+    for (size_t k : {2, 3, 4, 8, 16}) {
+        for (size_t c : {size_t(1), k}) {
+            chains(50, k, c, gen);
+        }
+    }
+    std::printf("inline capacity %d: %s\n", MATRIX_INLINE_CAPACITY, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
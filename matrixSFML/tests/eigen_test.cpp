@@ -0,0 +1,71 @@
+// Checks that matrices borrowed from Eigen objects with asMatrix() keep
+// writing to the Eigen memory when assigned expressions that read them:
+// asMatrix(e) = asMatrix(e) * b, m = m + m.transpose(), m *= b on either
+// side of the in-place limit, and the same on a block of a larger matrix,
+// whose rows are further apart than they are long.
+
+#include <cstdio>
+
+#include <Eigen/Core>
+
+#include "../eigen_interop.hpp"
+
+using matrix_eigen::RowMajorMatrix;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, long n) {
+    if (!ok) {
+        std::printf("FAILED: %s (n = %ld)\n", what, n);
+        failures++;
+    }
+}
+
+static bool near(const RowMajorMatrix<double>& a, const RowMajorMatrix<double>& b) {
+    return a.rows() == b.rows() && a.cols() == b.cols() &&
+           (a - b).cwiseAbs().maxCoeff() <= 1e-9 * (1 + b.cwiseAbs().maxCoeff());
+}
+
+static void borrowed(long n) {
+    RowMajorMatrix<double> e = RowMajorMatrix<double>::Random(n, n);
+    RowMajorMatrix<double> b = RowMajorMatrix<double>::Random(n, n);
+    Matrix<double> mb = matrix_eigen::asMatrix(b);
+
+    RowMajorMatrix<double> expected = e * b;
+    matrix_eigen::asMatrix(e) = matrix_eigen::asMatrix(e) * mb;
+    check(near(e, expected), "asMatrix(e) = asMatrix(e) * b writes into e", n);
+
+    Matrix<double> m = matrix_eigen::asMatrix(e);
+    expected = e + e.transpose();
+    m = m + m.transpose();
+    check(m.data() == e.data() && near(e, expected), "m = m + m.transpose() writes into e", n);
+
+    expected = e.transpose();
+    m = m.transpose();
+    check(m.data() == e.data() && near(e, expected), "m = m.transpose() writes into e", n);
+
+    expected = e * b;
+    m *= mb;
+    check(m.data() == e.data() && near(e, expected), "m *= b writes into e", n);
+
+    expected = (b + b) * e;
+    m = (mb + mb) * m;
+    check(m.data() == e.data() && near(e, expected), "m = (b + b) * m writes into e", n);
+
+    // Rows of the block are 2n apart
+    RowMajorMatrix<double> big = RowMajorMatrix<double>::Random(2 * n, 2 * n);
+    RowMajorMatrix<double> outside = big;
+    Matrix<double> block = matrix_eigen::asMatrix(big.block(0, n, n, n));
+    RowMajorMatrix<double> blockExpected = big.block(0, n, n, n) * b;
+    block *= mb;
+    outside.block(0, n, n, n) = blockExpected;
+    check(block.data() == &big(0, n) && near(big, outside), "block *= b writes into the block alone", n);
+}
+
+int main() {
+    for (long n : {2, 3, 16, 17, 40}) {
+        borrowed(n);
+    }
+    std::printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
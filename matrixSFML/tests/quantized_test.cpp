@@ -0,0 +1,247 @@
+// Checks the reduced-precision storage of quantized.hpp on every
+// instruction set the CPU has:
+//
+// - all 65536 Half and BFloat16 values decode to the floats they stand
+//   for, NaNs quieted, and encode back to themselves;
+// - floats around every rounding boundary (ties, and just either side)
+//   encode to the nearest Half or BFloat16, ties to even;
+// - transforms of a QuantizedSet<S> match those of the VectorSet<float>
+//   they came from within the bound in quantized.hpp: one rounding to S
+//   per component, of the input and of the result.
+//
+// The expected values are worked out independently of the conversions,
+// by arithmetic on doubles.
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../quantized.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint32_t value) {
+    if (!ok) {
+        if (failures < 20) {
+            std::printf("FAILED: %s (%s, 0x%08x)\n", what, simd::isaName(simd::activeIsa()), value);
+        }
+        failures++;
+    }
+}
+
+static uint32_t floatBits(float x) {
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static float bitsFloat(uint32_t bits) {
+    float x;
+    std::memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+// A 16-bit format: sign, 15 - fraction exponent bits, fraction bits
+struct Format {
+    int fraction;
+    int bias;
+};
+
+constexpr Format halfFormat = {10, 15};
+constexpr Format bfloat16Format = {7, 127};
+
+template <typename S>
+constexpr Format formatOf() {
+    return std::is_same<S, Half>::value ? halfFormat : bfloat16Format;
+}
+
+// The float bits a 16-bit value stands for; NaNs keep their payload on top
+// and come out quiet
+static uint32_t decoded(uint16_t bits, Format format) {
+    uint32_t sign = uint32_t(bits >> 15) << 31;
+    uint32_t exponentMax = (1u << (15 - format.fraction)) - 1;
+    uint32_t exponent = (bits & 0x7fffu) >> format.fraction;
+    uint32_t fraction = bits & ((1u << format.fraction) - 1);
+    if (exponent == exponentMax) {
+        return sign | 0x7f800000u | fraction << (23 - format.fraction) | (fraction ? 0x00400000u : 0u);
+    }
+    double x = exponent == 0 ? std::ldexp(double(fraction), 1 - format.bias - format.fraction)
+                             : std::ldexp(double(fraction | 1u << format.fraction),
+                                          int(exponent) - format.bias - format.fraction);
+    return sign | floatBits(float(x));
+}
+
+// The nearest 16-bit value to a float, ties to even; NaNs become quiet
+// NaNs with the top of their payload
+static uint16_t encoded(uint32_t f, Format format) {
+    uint32_t sign = f >> 16 & 0x8000u;
+    uint32_t magnitude = f & 0x7fffffffu;
+    uint32_t exponentMax = (1u << (15 - format.fraction)) - 1;
+    uint32_t infinity = exponentMax << format.fraction;
+    if (magnitude > 0x7f800000u) {
+        uint32_t payload = magnitude >> (23 - format.fraction) & ((1u << format.fraction) - 1);
+        return uint16_t(sign | infinity | 1u << (format.fraction - 1) | payload);
+    }
+    double x = bitsFloat(magnitude);
+    if (x == 0) {
+        return uint16_t(sign);
+    }
+    if (std::isinf(x)) {
+        return uint16_t(sign | infinity);
+    }
+    int e;
+    std::frexp(x, &e);
+    int exponent = e - 1; // x is in [2^exponent, 2^(exponent + 1))
+    int exponentMin = 1 - format.bias;
+    if (exponent < exponentMin) {
+        // Subnormal, or rounded up to the smallest normal
+        return uint16_t(sign | uint32_t(std::nearbyint(std::ldexp(x, format.fraction - exponentMin))));
+    }
+    if (exponent + format.bias >= int(exponentMax)) {
+        return uint16_t(sign | infinity);
+    }
+    uint32_t significand = uint32_t(std::nearbyint(std::ldexp(x, format.fraction - exponent)));
+    uint32_t bits = (uint32_t(exponent + format.bias) << format.fraction) + significand - (1u << format.fraction);
+    return uint16_t(sign | std::min(bits, infinity));
+}
+
+// Every 16-bit value, decoded and encoded back, through each path
+template <typename S>
+static void everyValue(bool once) {
+    constexpr Format format = formatOf<S>();
+    QuantizedSet<S> set(1, 65536);
+    for (uint32_t i = 0; i < 65536; i++) {
+        set.component(0)[i].bits = uint16_t(i);
+    }
+    VectorSet<float> values = set.decode();
+    QuantizedSet<S> back(values);
+    for (uint32_t i = 0; i < 65536; i++) {
+        uint32_t expected = decoded(uint16_t(i), format);
+        check(floatBits(values.component(0)[i]) == expected, "decode() gives the value", i);
+        // A NaN comes back quiet
+        uint16_t again = encoded(expected, format);
+        check(back.component(0)[i].bits == again, "encoding a decoded value gives it back", i);
+        check(again == i || std::isnan(bitsFloat(expected)), "values other than NaNs encode to themselves", i);
+        if (once) {
+            S s;
+            s.bits = uint16_t(i);
+            // BFloat16 widens by a shift, leaving signalling NaNs as they are
+            uint32_t widened = std::is_same<S, BFloat16>::value ? i << 16 : expected;
+            check(floatBits(float(s)) == widened, "conversion to float gives the value", i);
+            check(floatBits(set.getVector(i)(0, 0)) == expected, "getVector() gives the value", i);
+            check(S(bitsFloat(expected)).bits == again, "conversion from float gives it back", i);
+        }
+    }
+}
+
+// Floats on and either side of every rounding boundary of S, and in the
+// subnormal range of S, through each path
+template <typename S>
+static void roundingBoundaries(bool once) {
+    constexpr Format format = formatOf<S>();
+    int dropped = 23 - format.fraction;
+    uint32_t half = 1u << (dropped - 1);
+    std::vector<uint32_t> patterns;
+    for (uint32_t high = 0; high < 1u << (32 - dropped); high++) {
+        for (uint32_t low : {0u, 1u, half - 1, half, half + 1, (half << 1) - 1}) {
+            patterns.push_back(high << dropped | low);
+        }
+    }
+    std::mt19937 gen(5);
+    for (int i = 0; i < 1 << 20; i++) {
+        patterns.push_back(gen());
+    }
+
+    VectorSet<float> values(1, patterns.size());
+    for (size_t i = 0; i < patterns.size(); i++) {
+        values.component(0)[i] = bitsFloat(patterns[i]);
+    }
+    QuantizedSet<S> set(values);
+    for (size_t i = 0; i < patterns.size(); i++) {
+        uint16_t expected = encoded(patterns[i], format);
+        check(set.component(0)[i].bits == expected, "encoding rounds to nearest even", patterns[i]);
+        if (once) {
+            check(S(bitsFloat(patterns[i])).bits == expected, "conversion from float rounds to nearest even",
+                  patterns[i]);
+        }
+    }
+}
+
+// Transforms of the set stored as S against those of the float set
+template <typename S>
+static void accuracy(size_t dims, bool affine, std::mt19937& gen) {
+    size_t count = 10007;
+    std::uniform_real_distribution<float> dist(-50, 50);
+    VectorSet<float> points(dims, count);
+    for (size_t d = 0; d < dims; d++) {
+        for (size_t i = 0; i < count; i++) {
+            points.component(d)[i] = dist(gen);
+        }
+    }
+    size_t n = affine ? dims + 1 : dims;
+    Matrix<float> m(n, n);
+    std::uniform_real_distribution<float> coefficient(-2, 2);
+    for (size_t r = 0; r < n; r++) {
+        for (size_t c = 0; c < n; c++) {
+            m(r, c) = r < dims ? coefficient(gen) : float(r == c);
+        }
+    }
+
+    VectorSet<float> reference = points;
+    transform(m, reference);
+    QuantizedSet<S> set(points);
+    std::vector<float> inScales(dims);
+    for (size_t d = 0; d < dims; d++) {
+        inScales[d] = set.scale(d);
+    }
+    transform(m, set);
+    VectorSet<float> result = set.decode();
+
+    // Half and BFloat16 round relatively, int8_t to half a step
+    float u = std::is_same<S, Half>::value ? 0x1p-11f : 0x1p-8f;
+    for (size_t r = 0; r < dims; r++) {
+        for (size_t i = 0; i < count; i++) {
+            double spread = affine ? std::fabs(m(r, dims)) : 0.0, inputError = 0;
+            for (size_t c = 0; c < dims; c++) {
+                double term = std::fabs(double(m(r, c)) * points.component(c)[i]);
+                spread += term;
+                inputError += std::is_same<S, int8_t>::value ? std::fabs(m(r, c)) * inScales[c] / 2 : term * u;
+            }
+            double y = reference.component(r)[i];
+            double outputError = std::is_same<S, int8_t>::value ? set.scale(r) / 2 : std::fabs(y) * u;
+            double bound = 1.001 * (inputError + outputError) + 8 * FLT_EPSILON * spread + 1e-30;
+            check(std::fabs(result.component(r)[i] - y) <= bound, "transform is within the bound", uint32_t(i));
+        }
+    }
+}
+
+int main() {
+    std::mt19937 gen(3);
+    bool once = true;
+    for (simd::Isa isa : {simd::Isa::Scalar, simd::Isa::Baseline, simd::Isa::AVX2, simd::Isa::AVX512}) {
+        simd::setIsa(isa);
+        if (simd::activeIsa() != isa) {
+            continue;
+        }
+        everyValue<Half>(once);
+        everyValue<BFloat16>(once);
+        roundingBoundaries<Half>(once);
+        roundingBoundaries<BFloat16>(once);
+        once = false;
+
+        for (size_t dims : {2, 3}) {
+            for (bool affine : {false, true}) {
+                accuracy<Half>(dims, affine, gen);
+                accuracy<BFloat16>(dims, affine, gen);
+                accuracy<int8_t>(dims, affine, gen);
+            }
+        }
+        std::printf("%s checked\n", simd::isaName(isa));
+    }
+    std::printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
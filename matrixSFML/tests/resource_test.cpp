@@ -0,0 +1,153 @@
+// Checks that assigning an expression to a matrix keeps the matrix's
+// memory resource, also when the expression reads the matrix itself and
+// has to be built elsewhere first, and when the matrix changes shape:
+// a = a * b, c = c + c.transpose(), d = a + b into another shape, and
+// m *= b, for matrices of a MatrixArena and, with the arena installed as
+// the default resource, for matrices of the heap. A matrix mapped from a
+// file keeps writing to the mapped pages in the same assignments.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory_resource>
+#include <random>
+#include <string>
+
+#include "../arena.hpp"
+#include "../matrix.hpp"
+#include "../matrix_file.hpp"
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, size_t n) {
+    if (!ok) {
+        std::printf("FAILED: %s (n = %zu)\n", what, n);
+        failures++;
+    }
+}
+
+static void fill(Matrix<float>& a, std::mt19937& gen) {
+    std::uniform_real_distribution<float> dist(-1, 1);
+    for (size_t i = 0; i < a.getRows(); i++) {
+        for (size_t j = 0; j < a.getCols(); j++) {
+            a(i, j) = dist(gen);
+        }
+    }
+}
+
+static bool near(const Matrix<float>& a, const Matrix<float>& b) {
+    if (a.getRows() != b.getRows() || a.getCols() != b.getCols()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.getRows(); i++) {
+        for (size_t j = 0; j < a.getCols(); j++) {
+            if (std::abs(a(i, j) - b(i, j)) > 1e-4f * std::max(1.0f, std::abs(b(i, j)))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Every assignment into a matrix of resource, with operands from the heap
+static void assignments(std::pmr::memory_resource* resource, size_t n, std::mt19937& gen) {
+    std::pmr::memory_resource* heap = std::pmr::new_delete_resource();
+    Matrix<float> b(n, n, heap), c(n, 3, heap);
+    fill(b, gen);
+    fill(c, gen);
+
+    Matrix<float> a(n, n, resource);
+    fill(a, gen);
+    Matrix<float> expected = Matrix<float>(a) * b;
+    a = a * b;
+    check(a.getResource() == resource, "a = a * b keeps the resource", n);
+    check(near(a, expected), "a = a * b is the product", n);
+
+    expected = Matrix<float>(a) + Matrix<float>(a.transpose());
+    a = a + a.transpose();
+    check(a.getResource() == resource, "a = a + a.transpose() keeps the resource", n);
+    check(near(a, expected), "a = a + a.transpose() is the sum", n);
+
+    Matrix<float> tall(n, 3, resource);
+    fill(tall, gen);
+    expected = Matrix<float>(tall.transpose());
+    tall = tall.transpose();
+    check(tall.getResource() == resource, "m = m.transpose() keeps the resource", n);
+    check(near(tall, expected), "m = m.transpose() is the transpose", n);
+
+    Matrix<float> d(3, 3, resource);
+    d = b + b;
+    check(d.getResource() == resource, "d = b + b into another shape keeps the resource", n);
+    d = b * c;
+    check(d.getResource() == resource, "d = b * c into another shape keeps the resource", n);
+
+    Matrix<float> e(n, 3, resource);
+    fill(e, gen);
+    expected = (b + b) * Matrix<float>(e);
+    e = (b + b) * e;
+    check(e.getResource() == resource, "e = (b + b) * e keeps the resource", n);
+    check(near(e, expected), "e = (b + b) * e is the product", n);
+
+    Matrix<float> f(3, n, resource);
+    fill(f, gen);
+    expected = Matrix<float>(f) * (b - b.transpose());
+    f = f * (b - b.transpose());
+    check(f.getResource() == resource, "f = f * (b - b^T) keeps the resource", n);
+    check(near(f, expected), "f = f * (b - b^T) is the product", n);
+
+    expected = Matrix<float>(f) * b;
+    f *= b;
+    check(f.getResource() == resource, "f *= b keeps the resource", n);
+    check(near(f, expected), "f *= b is the product", n);
+}
+
+// Products of a mapped matrix and assignments that read it
+static void mapped(size_t n, std::mt19937& gen) {
+    Matrix<float> saved(n, n), b(n, n);
+    fill(saved, gen);
+    fill(b, gen);
+    std::string path = "resource_test_" + std::to_string(n) + ".mat";
+    matrix_file::save(path, saved);
+    {
+        auto file = matrix_file::mmapLoad<float>(path);
+        Matrix<float> m = file.matrix();
+        const float* pages = m.data();
+
+        Matrix<float> expected = saved * b;
+        m = m * b;
+        check(m.data() == pages && near(Matrix<float>(file.view()), expected), "m = m * b writes the mapped pages", n);
+
+        expected = expected * b;
+        m *= b;
+        check(m.data() == pages && near(Matrix<float>(file.view()), expected), "m *= b writes the mapped pages", n);
+
+        expected = Matrix<float>(expected.transpose());
+        m = m.transpose();
+        check(m.data() == pages && near(Matrix<float>(file.view()), expected),
+              "m = m.transpose() writes the mapped pages", n);
+    }
+    std::remove(path.c_str());
+}
+
+int main() {
+    std::mt19937 gen(11);
+    MatrixArena arena;
+    for (size_t n : {2, 8, 40}) {
+        assignments(&arena, n, gen);
+    }
+
+    // With the arena as the default, heap matrices must not pick up its
+    // buffers, which the next reset() hands out again
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(&arena);
+    for (size_t n : {2, 8, 40}) {
+        assignments(std::pmr::new_delete_resource(), n, gen);
+    }
+    std::pmr::set_default_resource(previous);
+
+    for (size_t n : {2, 8, 40}) {
+        mapped(n, gen);
+    }
+
+    std::printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,238 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <cstddef>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool behind the parallel matrix operations. Every worker
+// owns a task queue: it takes work from the back of its own queue and, when
+// that runs dry, steals from the front of the others. The thread that
+// starts a parallel loop works through the queues too instead of idling.
+class ThreadPool {
+public:
+    // A pool of n threads in total: n - 1 workers plus the calling thread
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return workers.size() + 1; }
+
+    // Runs body(i) for every i in [0, count) and returns once all of them
+    // have finished. The first exception thrown by body is rethrown here.
+    template <typename F>
+    void parallelFor(size_t count, const F& body);
+
+    // True on the pool's own worker threads
+    static bool onWorkerThread() { return workerFlag(); }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // One queue per worker, and a last one for the threads that submit work
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<size_t> pending{0};
+    bool stopping = false;
+
+    static bool& workerFlag() {
+        thread_local bool isWorker = false;
+        return isWorker;
+    }
+
+    bool tryRunTask(size_t self);
+    void workerLoop(size_t index);
+};
+
+inline ThreadPool::ThreadPool(size_t threads) {
+    size_t workerCount = threads > 1 ? threads - 1 : 0;
+    for (size_t i = 0; i <= workerCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Pops from the back of our own queue, or steals from the front of another
+inline bool ThreadPool::tryRunTask(size_t self) {
+    std::function<void()> task;
+    for (size_t n = 0; n < queues.size() && !task; n++) {
+        Queue& queue = *queues[(self + n) % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (n == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    pending.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+inline void ThreadPool::workerLoop(size_t index) {
+    workerFlag() = true;
+    while (true) {
+        if (tryRunTask(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || pending.load(std::memory_order_relaxed) > 0; });
+        if (stopping && pending.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+    }
+}
+
+template <typename F>
+void ThreadPool::parallelFor(size_t count, const F& body) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    // Lives on our stack; we don't return before every task is done with it
+    struct Batch {
+        std::atomic<size_t> remaining;
+        std::mutex errorLock;
+        std::exception_ptr error;
+    } batch;
+    batch.remaining.store(count, std::memory_order_relaxed);
+
+    // Deal the tasks out round-robin; stealing evens out whatever is left
+    pending.fetch_add(count, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++) {
+        Queue& queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.emplace_back([&batch, &body, i] {
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> errorGuard(batch.errorLock);
+                if (!batch.error) {
+                    batch.error = std::current_exception();
+                }
+            }
+            batch.remaining.fetch_sub(1, std::memory_order_release);
+        });
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wake.notify_all();
+
+    size_t self = queues.size() - 1;
+    while (batch.remaining.load(std::memory_order_acquire) > 0) {
+        if (!tryRunTask(self)) {
+            std::this_thread::yield();
+        }
+    }
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+// Process-wide pool used by the matrix operations
+namespace parallel {
+
+// Operations smaller than these run on the calling thread alone
+constexpr size_t gemmThreshold = 128 * 128 * 128;   // multiply-adds
+constexpr size_t elementwiseThreshold = 1 << 16;    // elements
+
+namespace detail {
+
+inline size_t defaultThreadCount() {
+    // MATRIX_NUM_THREADS sets the count, e.g. to a share of a batch node. It
+    // is taken as given, like setThreadCount(), even above the core count
+    if (const char* env = std::getenv("MATRIX_NUM_THREADS")) {
+        long requested = std::strtol(env, nullptr, 10);
+        if (requested > 0) {
+            return static_cast<size_t>(requested);
+        }
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline std::unique_ptr<ThreadPool>& poolStorage() {
+    static std::unique_ptr<ThreadPool> pool = std::make_unique<ThreadPool>(defaultThreadCount());
+    return pool;
+}
+
+} // namespace detail
+
+inline ThreadPool& pool() {
+    return *detail::poolStorage();
+}
+
+inline size_t threadCount() {
+    return pool().size();
+}
+
+// Sets how many threads the matrix operations may use, the caller included.
+// 0 restores the default; 1 makes everything serial. Must not be called
+// while a parallel operation is running.
+inline void setThreadCount(size_t threads) {
+    size_t count = threads == 0 ? detail::defaultThreadCount() : threads;
+    std::unique_ptr<ThreadPool>& current = detail::poolStorage();
+    if (current->size() != count) {
+        current.reset();
+        current = std::make_unique<ThreadPool>(count);
+    }
+}
+
+// Whether work of the given size should be split across the pool. Work
+// started from inside a pool task stays on that thread.
+inline bool worthSplitting(size_t work, size_t threshold) {
+    return work >= threshold && !ThreadPool::onWorkerThread() && threadCount() > 1;
+}
+
+template <typename F>
+void parallelFor(size_t count, const F& body) {
+    pool().parallelFor(count, body);
+}
+
+} // namespace parallel
+
+#endif // THREAD_POOL_HPP
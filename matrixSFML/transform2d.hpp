@@ -0,0 +1,148 @@
+#ifndef TRANSFORM2D_HPP
+#define TRANSFORM2D_HPP
+
+#include <stdexcept>
+
+#include "matrix.hpp"
+#include "vector_set.hpp"
+
+// A sequence of 2D transforms folded into one 3x3 matrix in homogeneous
+// coordinates, so that it can also translate. Each step is multiplied in
+// as it is added; applying the result costs one multiply per point no
+// matter how many steps went into it.
+//
+//     Transform2D<float> t;
+//     t.reflect(true, true).rotate(90).translate(1, 0);
+//     Matrix<float, 2, 1> moved = t.apply(point);
+//     t.apply(points); // a whole VectorSet<float>, in one pass
+//
+// Steps apply in the order they are added: the above reflects first.
+template <typename T>
+class Transform2D {
+public:
+    // The identity
+    constexpr Transform2D() : mat() {
+        mat(0, 0) = mat(1, 1) = mat(2, 2) = 1;
+    }
+
+    // Any 2x2 linear map; this is how the transform classes are added, e.g.
+    // then(ShearMatrix<T, 2>(1, 0)) or then(RotateMatrix<T>(30))
+    constexpr Transform2D& then(const Matrix<T, 2, 2>& linear);
+    Transform2D& then(const Matrix<T>& linear);
+
+    // Another transform, applied after this one
+    constexpr Transform2D& then(const Transform2D& next);
+
+    Transform2D& rotate(T angle);
+    constexpr Transform2D& scale(T scaleX, T scaleY);
+    constexpr Transform2D& shear(T shearX, T shearY);
+    constexpr Transform2D& reflect(bool reflectX, bool reflectY);
+    constexpr Transform2D& translate(T dx, T dy);
+
+    // The combined transform, with the last row always 0 0 1
+    constexpr const Matrix<T, 3, 3>& matrix() const { return mat; }
+
+    constexpr Matrix<T, 2, 1> apply(const Matrix<T, 2, 1>& vec) const;
+    Matrix<T> apply(const Matrix<T>& vec) const;
+    void apply(VectorSet<T>& points) const;
+
+private:
+    Matrix<T, 3, 3> mat;
+
+    // Left-multiplies a homogeneous step, so it applies after everything so far
+    constexpr Transform2D& append(const Matrix<T, 3, 3>& step) {
+        mat = step * mat;
+        return *this;
+    }
+
+    static constexpr Matrix<T, 3, 3> homogeneous(const Matrix<T, 2, 2>& linear) {
+        Matrix<T, 3, 3> step;
+        step(0, 0) = linear(0, 0);
+        step(0, 1) = linear(0, 1);
+        step(1, 0) = linear(1, 0);
+        step(1, 1) = linear(1, 1);
+        step(2, 2) = 1;
+        return step;
+    }
+};
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::then(const Matrix<T, 2, 2>& linear) {
+    return append(homogeneous(linear));
+}
+
+template <typename T>
+Transform2D<T>& Transform2D<T>::then(const Matrix<T>& linear) {
+    if (linear.getRows() != 2 || linear.getCols() != 2) {
+        throw runtime_error("Error: Only 2x2 matrices can be added to a 2D transform!");
+    }
+    Matrix<T, 2, 2> fixed;
+    for (size_t i = 0; i < 2; i++) {
+        for (size_t j = 0; j < 2; j++) {
+            fixed(i, j) = linear(i, j);
+        }
+    }
+    return then(fixed);
+}
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::then(const Transform2D& next) {
+    return append(next.mat);
+}
+
+template <typename T>
+Transform2D<T>& Transform2D<T>::rotate(T angle) {
+    return then(RotateMatrix<T, 2>(angle));
+}
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::scale(T scaleX, T scaleY) {
+    return then(ScaleMatrix<T, 2>(scaleX, scaleY));
+}
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::shear(T shearX, T shearY) {
+    return then(ShearMatrix<T, 2>(shearX, shearY));
+}
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::reflect(bool reflectX, bool reflectY) {
+    return then(ReflectMatrix<T, 2>(reflectX, reflectY));
+}
+
+template <typename T>
+constexpr Transform2D<T>& Transform2D<T>::translate(T dx, T dy) {
+    Matrix<T, 3, 3> step;
+    step(0, 0) = step(1, 1) = step(2, 2) = 1;
+    step(0, 2) = dx;
+    step(1, 2) = dy;
+    return append(step);
+}
+
+template <typename T>
+constexpr Matrix<T, 2, 1> Transform2D<T>::apply(const Matrix<T, 2, 1>& vec) const {
+    Matrix<T, 2, 1> result;
+    result(0, 0) = mat(0, 0) * vec(0, 0) + mat(0, 1) * vec(1, 0) + mat(0, 2);
+    result(1, 0) = mat(1, 0) * vec(0, 0) + mat(1, 1) * vec(1, 0) + mat(1, 2);
+    return result;
+}
+
+template <typename T>
+Matrix<T> Transform2D<T>::apply(const Matrix<T>& vec) const {
+    if (vec.getRows() != 2 || vec.getCols() != 1) {
+        throw runtime_error("Error: A 2D transform applies to 2x1 vectors only!");
+    }
+    Matrix<T> result(2, 1);
+    result(0, 0) = mat(0, 0) * vec(0, 0) + mat(0, 1) * vec(1, 0) + mat(0, 2);
+    result(1, 0) = mat(1, 0) * vec(0, 0) + mat(1, 1) * vec(1, 0) + mat(1, 2);
+    return result;
+}
+
+template <typename T>
+void Transform2D<T>::apply(VectorSet<T>& points) const {
+    transform(mat, points);
+}
+
+#endif // TRANSFORM2D_HPP
@@ -0,0 +1,209 @@
+#ifndef TRANSPOSE_HPP
+#define TRANSPOSE_HPP
+
+#include <cstddef>
+#include <algorithm>
+
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// Transposes on raw row-major buffers, out of place (dst = src^T) and in
+// place for square matrices.
+//
+// A straightforward loop reads one of the two matrices down its columns,
+// touching a new cache line (and, for large matrices, a new page) on every
+// element. Here the matrix is halved along its longer side until a block
+// fits in L1, whatever the cache sizes are, and each block is copied in
+// B x B tiles that a micro-kernel from simd.hpp transposes in registers.
+// Every cache line that is loaded is then used in full before it is
+// evicted.
+namespace layout {
+
+// Blocks of at most this many elements are copied tile by tile
+constexpr size_t leafElements = 32 * 32;
+
+// In-place transposes are split into square blocks of this size, which
+// the pool can work on independently
+constexpr size_t inPlaceBlock = 256;
+
+// The tiles of an m x n block, with a scalar loop for the ragged edges.
+// Tiles are taken down each column of tiles, so consecutive kernel calls
+// finish whole cache lines of dst instead of leaving partial ones behind.
+template <typename T, typename Kernel>
+void transposeTiles(size_t m, size_t n, const T* src, size_t lds, T* dst, size_t ldd) {
+    constexpr size_t B = Kernel::B;
+    size_t mFull = m / B * B, nFull = n / B * B;
+    for (size_t j = 0; j < nFull; j += B) {
+        for (size_t i = 0; i < mFull; i += B) {
+            Kernel::run(src + i * lds + j, lds, dst + j * ldd + i, ldd);
+        }
+    }
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = i < mFull ? nFull : 0; j < n; j++) {
+            dst[j * ldd + i] = src[i * lds + j];
+        }
+    }
+}
+
+// dst = src^T for an m x n src: halves the longer side until the block is
+// small enough to tile. Split points stay multiples of the tile size.
+template <typename T, typename Kernel>
+void transposeBlock(size_t m, size_t n, const T* src, size_t lds, T* dst, size_t ldd) {
+    constexpr size_t B = Kernel::B;
+    if (m * n <= leafElements || (m <= B && n <= B)) {
+        transposeTiles<T, Kernel>(m, n, src, lds, dst, ldd);
+    } else if (m >= n) {
+        size_t half = std::max(B, m / 2 / B * B);
+        transposeBlock<T, Kernel>(half, n, src, lds, dst, ldd);
+        transposeBlock<T, Kernel>(m - half, n, src + half * lds, lds, dst + half, ldd);
+    } else {
+        size_t half = std::max(B, n / 2 / B * B);
+        transposeBlock<T, Kernel>(m, half, src, lds, dst, ldd);
+        transposeBlock<T, Kernel>(m, n - half, src + half, lds, dst + half * ldd, ldd);
+    }
+}
+
+// Exchanges the m x n block a with the n x m block b, transposing both:
+// a = b^T and b = a^T at once. A tile of a goes through a buffer on the
+// stack while the matching tile of b is written over it.
+template <typename T, typename Kernel>
+void swapBlock(size_t m, size_t n, T* a, T* b, size_t ld) {
+    constexpr size_t B = Kernel::B;
+    if (m * n > leafElements && (m > B || n > B)) {
+        if (m >= n) {
+            size_t half = std::max(B, m / 2 / B * B);
+            swapBlock<T, Kernel>(half, n, a, b, ld);
+            swapBlock<T, Kernel>(m - half, n, a + half * ld, b + half, ld);
+        } else {
+            size_t half = std::max(B, n / 2 / B * B);
+            swapBlock<T, Kernel>(m, half, a, b, ld);
+            swapBlock<T, Kernel>(m, n - half, a + half, b + half * ld, ld);
+        }
+        return;
+    }
+    size_t mFull = m / B * B, nFull = n / B * B;
+    T tile[B * B];
+    for (size_t i = 0; i < mFull; i += B) {
+        for (size_t j = 0; j < nFull; j += B) {
+            T* x = a + i * ld + j;
+            T* y = b + j * ld + i;
+            Kernel::run(x, ld, tile, B);
+            Kernel::run(y, ld, x, ld);
+            for (size_t r = 0; r < B; r++) {
+                std::copy_n(tile + r * B, B, y + r * ld);
+            }
+        }
+    }
+    for (size_t i = 0; i < m; i++) {
+        for (size_t j = i < mFull ? nFull : 0; j < n; j++) {
+            std::swap(a[i * ld + j], b[j * ld + i]);
+        }
+    }
+}
+
+// Transposes the n x n block a onto itself
+template <typename T, typename Kernel>
+void transposeSquare(size_t n, T* a, size_t ld) {
+    constexpr size_t B = Kernel::B;
+    if (n <= B) {
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i + 1; j < n; j++) {
+                std::swap(a[i * ld + j], a[j * ld + i]);
+            }
+        }
+        return;
+    }
+    // [A B; C D] becomes [A^T C^T; B^T D^T]
+    size_t half = std::max(B, n / 2 / B * B);
+    transposeSquare<T, Kernel>(half, a, ld);
+    transposeSquare<T, Kernel>(n - half, a + half * ld + half, ld);
+    swapBlock<T, Kernel>(half, n - half, a + half, a + half * ld, ld);
+}
+
+template <typename T, typename Kernel>
+void transposeWith(size_t m, size_t n, const T* src, size_t lds, T* dst, size_t ldd) {
+    // Large matrices are split into bands of source rows across the pool;
+    // each band writes its own columns of dst
+    if (parallel::worthSplitting(m * n, parallel::elementwiseThreshold)) {
+        size_t bandRows = std::max<size_t>(Kernel::B, m / (4 * parallel::threadCount()) / Kernel::B * Kernel::B);
+        size_t bands = (m + bandRows - 1) / bandRows;
+        parallel::parallelFor(bands, [&](size_t band) {
+            size_t begin = band * bandRows;
+            size_t rows = std::min(bandRows, m - begin);
+            transposeBlock<T, Kernel>(rows, n, src + begin * lds, lds, dst + begin, ldd);
+        });
+    } else {
+        transposeBlock<T, Kernel>(m, n, src, lds, dst, ldd);
+    }
+}
+
+template <typename T, typename Kernel>
+void transposeInPlaceWith(size_t n, T* a, size_t ld) {
+    if (!parallel::worthSplitting(n * n, parallel::elementwiseThreshold)) {
+        transposeSquare<T, Kernel>(n, a, ld);
+        return;
+    }
+    // Every diagonal block and every pair of mirrored blocks is a task
+    size_t blocks = (n + inPlaceBlock - 1) / inPlaceBlock;
+    parallel::parallelFor(blocks * (blocks + 1) / 2, [&](size_t task) {
+        size_t bi = 0;
+        while (task >= blocks - bi) {
+            task -= blocks - bi;
+            bi++;
+        }
+        size_t bj = bi + task;
+        size_t i = bi * inPlaceBlock, j = bj * inPlaceBlock;
+        size_t rows = std::min(inPlaceBlock, n - i), cols = std::min(inPlaceBlock, n - j);
+        if (bi == bj) {
+            transposeSquare<T, Kernel>(rows, a + i * ld + i, ld);
+        } else {
+            swapBlock<T, Kernel>(rows, cols, a + i * ld + j, a + j * ld + i, ld);
+        }
+    });
+}
+
+// dst = src^T, where src is m x n with row stride lds and dst is n x m with
+// row stride ldd. The two must not overlap.
+template <typename T>
+void transpose(size_t m, size_t n, const T* src, size_t lds, T* dst, size_t ldd) {
+    if (m == 0 || n == 0) {
+        return;
+    }
+    switch (simd::activeIsa()) {
+    case simd::Isa::AVX512:
+        transposeWith<T, simd::Avx512Transpose<T>>(m, n, src, lds, dst, ldd);
+        break;
+    case simd::Isa::AVX2:
+        transposeWith<T, simd::Avx2Transpose<T>>(m, n, src, lds, dst, ldd);
+        break;
+    case simd::Isa::Baseline:
+        transposeWith<T, simd::BaselineTranspose<T>>(m, n, src, lds, dst, ldd);
+        break;
+    case simd::Isa::Scalar:
+        transposeWith<T, simd::ScalarTranspose<T>>(m, n, src, lds, dst, ldd);
+        break;
+    }
+}
+
+// a = a^T for an n x n matrix with row stride ld
+template <typename T>
+void transposeInPlace(size_t n, T* a, size_t ld) {
+    switch (simd::activeIsa()) {
+    case simd::Isa::AVX512:
+        transposeInPlaceWith<T, simd::Avx512Transpose<T>>(n, a, ld);
+        break;
+    case simd::Isa::AVX2:
+        transposeInPlaceWith<T, simd::Avx2Transpose<T>>(n, a, ld);
+        break;
+    case simd::Isa::Baseline:
+        transposeInPlaceWith<T, simd::BaselineTranspose<T>>(n, a, ld);
+        break;
+    case simd::Isa::Scalar:
+        transposeInPlaceWith<T, simd::ScalarTranspose<T>>(n, a, ld);
+        break;
+    }
+}
+
+} // namespace layout
+
+#endif // TRANSPOSE_HPP
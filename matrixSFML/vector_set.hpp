@@ -0,0 +1,269 @@
+#ifndef VECTOR_SET_HPP
+#define VECTOR_SET_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "matrix.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+// A set of N vectors of the same dimension, stored as a structure of
+// arrays: all x components, then all y components, and so on. transform()
+// applies one matrix to every vector in the set, a vector register of
+// points at a time, which is what the one-vector vectorToMatrix /
+// matrixToVector round trip can't do for large point clouds.
+//
+// The components are the rows of a dims x N Matrix<T>, so the set is one
+// aligned allocation and can come from any memory resource. Each row is
+// padded to a whole cache line.
+template <typename T>
+class VectorSet {
+public:
+    VectorSet() : dims(0), count(0) {}
+    VectorSet(size_t dims, size_t count, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+    size_t getDims() const { return dims; }
+    size_t size() const { return count; }
+
+    // The d-th component of every vector, contiguous
+    T* component(size_t d) { return &components(d, 0); }
+    const T* component(size_t d) const { return &components(d, 0); }
+
+    // Copies vector i in or out as a dims x 1 column, like vectorToMatrix
+    Matrix<T> getVector(size_t i) const;
+    void setVector(size_t i, const Matrix<T>& vec);
+
+private:
+    static constexpr size_t padding = 64 / sizeof(T) > 0 ? 64 / sizeof(T) : 1;
+
+    size_t dims, count;
+    Matrix<T> components;
+};
+
+// Replaces every vector v in the set with m * v. m is either square with
+// the set's dimension, which the transform classes are in either form,
+//
+//     transform(RotateMatrix<float>(30), points);
+//     transform(ShearMatrix<float, 2>(0.5f, 0), points);
+//
+// or one larger and affine in homogeneous coordinates (last row 0 ... 0 1),
+// which adds its last column as a translation in the same pass.
+template <typename T>
+void transform(const Matrix<T>& m, VectorSet<T>& set);
+
+template <typename T, size_t N>
+void transform(const Matrix<T, N, N>& m, VectorSet<T>& set);
+
+// Writes m * v for every vector v of in to out, which must have the same
+// shape; out may be in
+template <typename T>
+void transform(const Matrix<T>& m, const VectorSet<T>& in, VectorSet<T>& out);
+
+// ------------------ KERNELS ------------------
+
+namespace detail {
+
+// Sets smaller than this are transformed on the calling thread
+constexpr size_t vectorSetThreshold = 1 << 15;
+
+// out = m * in for points [begin, end), where m is D x (D + 1) row-major:
+// a linear part plus a translation column. V is either T itself or a
+// vector of T; all D inputs are loaded before any output is stored, so out
+// may alias in.
+template <size_t D, typename V, typename T>
+SIMD_INLINE void transformPoints(const T* m, const T* const* in, T* const* out, size_t begin, size_t end) {
+    constexpr size_t W = sizeof(V) / sizeof(T);
+    size_t i = begin;
+    for (; i + W <= end; i += W) {
+        V x[D];
+        for (size_t c = 0; c < D; c++) {
+            std::memcpy(&x[c], in[c] + i, sizeof(V));
+        }
+        for (size_t r = 0; r < D; r++) {
+            const T* row = m + r * (D + 1);
+            V acc = row[D] + row[0] * x[0];
+            for (size_t c = 1; c < D; c++) {
+                acc += row[c] * x[c];
+            }
+            std::memcpy(out[r] + i, &acc, sizeof(V));
+        }
+    }
+    if constexpr (W > 1) {
+        transformPoints<D, T>(m, in, out, i, end);
+    }
+}
+
+#if SIMD_X86
+template <size_t D, typename T>
+SIMD_TARGET_AVX2 void transformPointsAvx2(const T* m, const T* const* in, T* const* out, size_t begin, size_t end) {
+    transformPoints<D, typename simd::VectorType<T, 32>::type>(m, in, out, begin, end);
+}
+
+template <size_t D, typename T>
+SIMD_TARGET_AVX512 void transformPointsAvx512(const T* m, const T* const* in, T* const* out, size_t begin, size_t end) {
+    transformPoints<D, typename simd::VectorType<T, 64>::type>(m, in, out, begin, end);
+}
+#endif
+
+template <size_t D, typename T>
+void transformRange(const T* m, const T* const* in, T* const* out, size_t begin, size_t end) {
+    if constexpr (simd::isVectorizable<T> && simd::hasBaselineVector<T>) {
+        switch (simd::activeIsa()) {
+#if SIMD_X86
+        case simd::Isa::AVX512: transformPointsAvx512<D>(m, in, out, begin, end); return;
+        case simd::Isa::AVX2: transformPointsAvx2<D>(m, in, out, begin, end); return;
+#endif
+        case simd::Isa::Baseline:
+            transformPoints<D, typename simd::BaselineVector<T>::type>(m, in, out, begin, end);
+            return;
+        default: break;
+        }
+    }
+    transformPoints<D, T>(m, in, out, begin, end);
+}
+
+// Any other dimension, a point at a time
+template <typename T>
+void transformRangeGeneric(size_t dims, const T* m, const T* const* in, T* const* out,
+                           size_t begin, size_t end) {
+    std::vector<T> x(dims);
+    for (size_t i = begin; i < end; i++) {
+        for (size_t c = 0; c < dims; c++) {
+            x[c] = in[c][i];
+        }
+        for (size_t r = 0; r < dims; r++) {
+            const T* row = m + r * (dims + 1);
+            T acc = row[dims];
+            for (size_t c = 0; c < dims; c++) {
+                acc += row[c] * x[c];
+            }
+            out[r][i] = acc;
+        }
+    }
+}
+
+// m is dims x (dims + 1), row-major and contiguous
+template <typename T>
+void transformSet(const T* m, const VectorSet<T>& in, VectorSet<T>& out) {
+    size_t dims = in.getDims();
+    std::vector<const T*> src(dims);
+    std::vector<T*> dst(dims);
+    for (size_t d = 0; d < dims; d++) {
+        src[d] = in.component(d);
+        dst[d] = out.component(d);
+    }
+
+    auto range = [&](size_t begin, size_t end) {
+        if (dims == 2) {
+            transformRange<2>(m, src.data(), dst.data(), begin, end);
+        } else if (dims == 3) {
+            transformRange<3>(m, src.data(), dst.data(), begin, end);
+        } else {
+            transformRangeGeneric(dims, m, src.data(), dst.data(), begin, end);
+        }
+    };
+
+    // Cache-line aligned slices, a few per thread
+    size_t count = in.size();
+    if (parallel::worthSplitting(count, vectorSetThreshold)) {
+        size_t slices = 4 * parallel::threadCount();
+        size_t slice = (count + slices - 1) / slices;
+        slice = (slice + 63) / 64 * 64;
+        parallel::parallelFor((count + slice - 1) / slice, [&](size_t s) {
+            range(s * slice, std::min(count, (s + 1) * slice));
+        });
+    } else {
+        range(0, count);
+    }
+}
+
+template <typename T>
+void checkTransform(size_t rows, size_t cols, const VectorSet<T>& in, const VectorSet<T>& out) {
+    size_t dims = in.getDims();
+    if (rows != cols || (rows != dims && rows != dims + 1)) {
+        throw runtime_error("Error: Transform must be square and match the vector dimension!");
+    }
+    if (out.getDims() != in.getDims() || out.size() != in.size()) {
+        throw runtime_error("Error: Vector sets must have the same shape!");
+    }
+}
+
+// Lays a linear or homogeneous affine matrix out as the kernels' D x (D + 1)
+// coefficients. at(i, j) reads element (i, j) of the matrix.
+template <typename T, typename At>
+std::vector<T> affineCoefficients(size_t size, size_t dims, At at) {
+    std::vector<T> coeffs(dims * (dims + 1), T(0));
+    for (size_t i = 0; i < dims; i++) {
+        for (size_t j = 0; j < size; j++) {
+            coeffs[i * (dims + 1) + j] = at(i, j);
+        }
+    }
+    if (size == dims + 1) {
+        for (size_t j = 0; j < size; j++) {
+            if (at(dims, j) != (j == dims ? T(1) : T(0))) {
+                throw runtime_error("Error: Only affine transforms can be applied to a vector set!");
+            }
+        }
+    }
+    return coeffs;
+}
+
+} // namespace detail
+
+// ------------------ DEFINITIONS ------------------
+
+template <typename T>
+VectorSet<T>::VectorSet(size_t dims, size_t count, std::pmr::memory_resource* resource)
+: dims(dims), count(count), components(dims, (count + padding - 1) / padding * padding, resource) {}
+
+template <typename T>
+Matrix<T> VectorSet<T>::getVector(size_t i) const {
+    if (i >= count) {
+        throw std::out_of_range("Vector index out of range");
+    }
+    Matrix<T> vec(dims, 1);
+    for (size_t d = 0; d < dims; d++) {
+        vec(d, 0) = components(d, i);
+    }
+    return vec;
+}
+
+template <typename T>
+void VectorSet<T>::setVector(size_t i, const Matrix<T>& vec) {
+    if (i >= count) {
+        throw std::out_of_range("Vector index out of range");
+    }
+    if (vec.getRows() != dims || vec.getCols() != 1) {
+        throw runtime_error("Error: Vector does not match the set's dimension!");
+    }
+    for (size_t d = 0; d < dims; d++) {
+        components(d, i) = vec(d, 0);
+    }
+}
+
+template <typename T>
+void transform(const Matrix<T>& m, const VectorSet<T>& in, VectorSet<T>& out) {
+    detail::checkTransform(m.getRows(), m.getCols(), in, out);
+    // Copy the coefficients out so the kernels see a dense, unaliased block
+    std::vector<T> coeffs = detail::affineCoefficients<T>(m.getRows(), in.getDims(),
+                                                          [&](size_t i, size_t j) { return m(i, j); });
+    detail::transformSet(coeffs.data(), in, out);
+}
+
+template <typename T>
+void transform(const Matrix<T>& m, VectorSet<T>& set) {
+    transform(m, set, set);
+}
+
+template <typename T, size_t N>
+void transform(const Matrix<T, N, N>& m, VectorSet<T>& set) {
+    detail::checkTransform(N, N, set, set);
+    std::vector<T> coeffs = detail::affineCoefficients<T>(N, set.getDims(),
+                                                          [&](size_t i, size_t j) { return m(i, j); });
+    detail::transformSet(coeffs.data(), set, set);
+}
+
+#endif // VECTOR_SET_HPP